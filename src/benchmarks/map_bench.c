@@ -30,8 +30,8 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 /*
- * map_bench.c -- benchmarks for: ctree, btree, rbtree, hashmap_atomic
- * and hashmap_tx from examples.
+ * map_bench.c -- benchmarks for: ctree, btree, rbtree, skiplist,
+ * skiplist_mt, art_olc, hashmap_atomic and hashmap_tx from examples.
  */
 #include <assert.h>
 #include <pthread.h>
@@ -41,6 +41,8 @@
 #include "map_ctree.h"
 #include "map_btree.h"
 #include "map_rbtree.h"
+#include "map_skiplist.h"
+#include "map_art_olc.h"
 #include "map_hashmap_atomic.h"
 #include "map_hashmap_tx.h"
 #include <stdint.h>
@@ -67,12 +69,16 @@ struct root {
 static const struct {
 	const char *str;
 	const struct map_ops *ops;
+	bool concurrent; /* operations need no external locking */
 } map_types[] = {
-	{"ctree",		MAP_CTREE},
-	{"btree",		MAP_BTREE},
-	{"rbtree",		MAP_RBTREE},
-	{"hashmap_tx",		MAP_HASHMAP_TX},
-	{"hashmap_atomic",	MAP_HASHMAP_ATOMIC},
+	{"ctree",		MAP_CTREE,		false},
+	{"btree",		MAP_BTREE,		false},
+	{"rbtree",		MAP_RBTREE,		false},
+	{"skiplist",		MAP_SKIPLIST,		false},
+	{"skiplist_mt",		MAP_SKIPLIST_MT,	true},
+	{"art_olc",		MAP_ART_OLC,		true},
+	{"hashmap_tx",		MAP_HASHMAP_TX,		false},
+	{"hashmap_atomic",	MAP_HASHMAP_ATOMIC,	false},
 };
 
 #define MAP_TYPES_NUM	(sizeof(map_types) / sizeof(map_types[0]))
@@ -83,6 +89,7 @@ struct map_bench_args {
 	char *type;
 	bool ext_tx;
 	bool alloc;
+	unsigned int scan_len;
 };
 
 struct map_bench_worker {
@@ -93,6 +100,7 @@ struct map_bench_worker {
 struct map_bench {
 	struct map_ctx *mapc;
 	pthread_mutex_t lock;
+	bool concurrent;
 	PMEMobjpool *pop;
 	off_t pool_size;
 
@@ -116,7 +124,8 @@ static struct benchmark_clo map_bench_clos[] = {
 		.opt_short	= 'T',
 		.opt_long	= "type",
 		.descr		= "Type of container "
-			"[ctree|btree|rbtree|hashmap_tx|hashmap_atomic]",
+			"[ctree|btree|rbtree|skiplist|skiplist_mt|art_olc|"
+			"hashmap_tx|hashmap_atomic]",
 		.off		= clo_field_offset(struct map_bench_args, type),
 		.type		= CLO_TYPE_STR,
 		.def		= "ctree",
@@ -168,6 +177,23 @@ static struct benchmark_clo map_bench_clos[] = {
 						alloc),
 		.type		= CLO_TYPE_FLAG,
 	},
+	{
+		.opt_short	= 0,
+		.opt_long	= "scan-length",
+		.descr		= "Number of pairs visited by a single scan "
+				"(map_scan only)",
+		.off		= clo_field_offset(struct map_bench_args,
+						scan_len),
+		.type		= CLO_TYPE_UINT,
+		.def		= "100",
+		.type_uint = {
+			.size	= clo_field_size(struct map_bench_args,
+						scan_len),
+			.base	= CLO_INT_BASE_DEC,
+			.min	= 1,
+			.max	= UINT_MAX,
+		},
+	},
 };
 //zyu
 static void 
@@ -206,6 +232,26 @@ mutex_unlock_nofail(pthread_mutex_t *lock)
 	}
 }
 
+/*
+ * map_lock -- serializes operations on maps which are not thread-safe
+ */
+static void
+map_lock(struct map_bench *map_bench)
+{
+	if (!map_bench->concurrent)
+		mutex_lock_nofail(&map_bench->lock);
+}
+
+/*
+ * map_unlock -- counterpart of map_lock
+ */
+static void
+map_unlock(struct map_bench *map_bench)
+{
+	if (!map_bench->concurrent)
+		mutex_unlock_nofail(&map_bench->lock);
+}
+
 /*
  * get_key -- return 64-bit random key
  */
@@ -226,11 +272,13 @@ get_key(unsigned int *seed, uint64_t max_key)
  * parse_map_type -- parse type of map
  */
 static const struct map_ops *
-parse_map_type(const char *str)
+parse_map_type(const char *str, bool *concurrent)
 {
 	for (int i = 0; i < MAP_TYPES_NUM; i++) {
-		if (strcmp(str, map_types[i].str) == 0)
+		if (strcmp(str, map_types[i].str) == 0) {
+			*concurrent = map_types[i].concurrent;
 			return map_types[i].ops;
+		}
 	}
 
 	return NULL;
@@ -277,11 +325,11 @@ map_remove_op(struct benchmark *bench, struct operation_info *info)
 	struct map_bench_worker *tworker = info->worker->priv;
 	uint64_t key = tworker->keys[info->index];
 
-	mutex_lock_nofail(&map_bench->lock);
+	map_lock(map_bench);
 
 	int ret = map_bench->remove(map_bench, key);
 
-	mutex_unlock_nofail(&map_bench->lock);
+	map_unlock(map_bench);
 
 	return ret;
 }
@@ -335,7 +383,7 @@ map_insert_op(struct benchmark *bench, struct operation_info *info)
 	struct map_bench_worker *tworker = info->worker->priv;
 	// should only have key
 	uint64_t key = tworker->keys[info->index];
-	mutex_lock_nofail(&map_bench->lock);
+	map_lock(map_bench);
 	uint64_t cycles = get_cycles();
 	//zyu: CPU cycles and operation type
 	printf("%lu W", cycles);
@@ -343,7 +391,7 @@ map_insert_op(struct benchmark *bench, struct operation_info *info)
 	//zyu: thread id
 	printf(" %u\n",info->worker->index);
 	fflush(stdout);
-	mutex_unlock_nofail(&map_bench->lock);
+	map_unlock(map_bench);
 	return ret;
 }
 
@@ -379,15 +427,52 @@ map_get_op(struct benchmark *bench, struct operation_info *info)
 	struct map_bench_worker *tworker = info->worker->priv;
 	uint64_t key = tworker->keys[info->index];
 
-	mutex_lock_nofail(&map_bench->lock);
+	map_lock(map_bench);
 
 	int ret = map_bench->get(map_bench, key);
 
-	mutex_unlock_nofail(&map_bench->lock);
+	map_unlock(map_bench);
 
 	return ret;
 }
 
+/*
+ * map_scan_cb -- callback for pairs visited by the map_scan benchmark
+ */
+static int
+map_scan_cb(uint64_t key, PMEMoid value, void *arg)
+{
+	size_t *count = arg;
+	(*count)++;
+
+	return 0;
+}
+
+/*
+ * map_scan_op -- main operation for map_scan benchmark
+ */
+static int
+map_scan_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct map_bench *map_bench = pmembench_get_priv(bench);
+	struct map_bench_worker *tworker = info->worker->priv;
+	uint64_t key = tworker->keys[info->index];
+	size_t count = 0;
+
+	struct map_iter iter;
+	map_iter_seek(&iter, key, UINT64_MAX);
+
+	map_lock(map_bench);
+
+	map_iter_next(map_bench->mapc, map_bench->map, &iter,
+			map_bench->margs->scan_len, map_scan_cb, &count);
+
+	map_unlock(map_bench);
+
+	/* the scan starts at an existing key */
+	return count == 0;
+}
+
 /*
  * map_common_init_worker -- common init worker function for map_* benchmarks
  */
@@ -556,7 +641,8 @@ map_common_init(struct benchmark *bench, struct benchmark_args *args)
 	map_bench->args = args;
 	map_bench->margs = args->opts;
 
-	const struct map_ops *ops = parse_map_type(map_bench->margs->type);
+	const struct map_ops *ops = parse_map_type(map_bench->margs->type,
+			&map_bench->concurrent);
 	if (!ops) {
 		fprintf(stderr, "invalid map type value specified -- '%s'\n",
 				map_bench->margs->type);
@@ -777,6 +863,33 @@ err_exit_common:
 	return -1;
 }
 
+/*
+ * map_scan_init -- init function for map_scan benchmark
+ */
+static int
+map_scan_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	int ret = map_common_init(bench, args);
+	if (ret)
+		return ret;
+
+	struct map_bench *map_bench = pmembench_get_priv(bench);
+	if (map_bench->mapc->ops->range == NULL) {
+		fprintf(stderr, "range scans not supported by map type -- "
+				"'%s'\n", map_bench->margs->type);
+		goto err_exit_common;
+	}
+
+	ret = map_keys_init(bench, args);
+	if (ret)
+		goto err_exit_common;
+
+	return 0;
+err_exit_common:
+	map_common_exit(bench, args);
+	return -1;
+}
+
 /*
  * map_get_exit -- exit function for map_get benchmark
  */
@@ -843,3 +956,22 @@ static struct benchmark_info map_get_info = {
 	.allow_poolset	= true,
 };
 REGISTER_BENCHMARK(map_get_info);
+
+static struct benchmark_info map_scan_info = {
+	.name		= "map_scan",
+	.brief		= "Ordered range scan of tree map",
+	.init		= map_scan_init,
+	.exit		= map_get_exit,
+	.multithread	= true,
+	.multiops	= true,
+	.init_worker	= map_bench_get_init_worker,
+	.free_worker	= map_common_free_worker,
+	.operation	= map_scan_op,
+	.measure_time	= true,
+	.clos		= map_bench_clos,
+	.nclos		= ARRAY_SIZE(map_bench_clos),
+	.opts_size	= sizeof(struct map_bench_args),
+	.rm_file	= true,
+	.allow_poolset	= true,
+};
+REGISTER_BENCHMARK(map_scan_info);
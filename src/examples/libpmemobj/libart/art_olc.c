@@ -0,0 +1,1991 @@
+/*
+ * Copyright 2015-2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * art_olc.c -- concurrent adaptive radix tree with optimistic lock coupling
+ *
+ * The inner nodes (Node4, Node16, Node48 and Node256) and the leaves are
+ * stored in the pool, the references between them are 8-byte pool offsets
+ * with the lowest bit set for leaves. Every structural change -- growing,
+ * shrinking, splitting the compressed path of a node or collapsing a node
+ * with a single child -- builds the new node aside and publishes it with a
+ * single 8-byte store to the slot of the parent followed by a persist, so
+ * no transaction is needed and the tree is consistent at any point. A child
+ * is added to a node in place by writing a free slot first and publishing
+ * it by setting a bit in the bitmap (Node4, Node16) or a byte in the index
+ * (Node48) afterwards; removing a child clears the bitmap bit or the index
+ * byte first. Nodes and leaves left unreachable by an interrupted operation
+ * are freed on the first access after the pool is opened.
+ *
+ * Synchronization follows the optimistic lock coupling scheme: the version
+ * counters are kept in DRAM only, in a table indexed by a hash of the node
+ * offset. Readers never write shared memory, they validate the version of
+ * the node after reading it and restart on a conflict. Writers upgrade the
+ * versions they have read to locks, which fails instead of waiting, so no
+ * deadlock is possible even if two nodes share a counter. Memory of the
+ * replaced nodes and removed leaves is reclaimed once no other operation on
+ * the tree is in progress.
+ */
+
+#include <emmintrin.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "art_olc.h"
+
+#define ART_OLC_PREFIX 8		/* path bytes stored in a node */
+#define ART_OLC_VERSIONS_SHIFT 14	/* log2 of the number of versions */
+#define ART_OLC_VERSIONS (1 << ART_OLC_VERSIONS_SHIFT)
+
+#define ART_OLC_LEAF 1ULL		/* the reference points to a leaf */
+
+#define REF_OFF(r) ((r) & ~ART_OLC_LEAF)
+#define IS_LEAF(r) ((r) & ART_OLC_LEAF)
+
+#define NODE(pop, r) ((struct art_olc_header *)((uintptr_t)(pop) + (r)))
+#define LEAF(pop, r)\
+((struct art_olc_leaf *)((uintptr_t)(pop) + REF_OFF(r)))
+
+#define LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+
+enum art_olc_node_type {
+	ART_OLC_NODE4,
+	ART_OLC_NODE16,
+	ART_OLC_NODE48,
+	ART_OLC_NODE256,
+
+	MAX_ART_OLC_NODE
+};
+
+TOID_DECLARE(struct art_olc_node4, ART_OLC_TYPE_OFFSET + 1);
+TOID_DECLARE(struct art_olc_node16, ART_OLC_TYPE_OFFSET + 2);
+TOID_DECLARE(struct art_olc_node48, ART_OLC_TYPE_OFFSET + 3);
+TOID_DECLARE(struct art_olc_node256, ART_OLC_TYPE_OFFSET + 4);
+TOID_DECLARE(struct art_olc_leaf, ART_OLC_TYPE_OFFSET + 5);
+
+/* header of an inner node, never modified once the node is published */
+struct art_olc_header {
+	uint8_t type;
+	uint8_t unused[3];
+	uint32_t prefix_len;		/* length of the compressed path */
+	uint8_t prefix[ART_OLC_PREFIX];	/* its leading bytes */
+	uint64_t map;			/* offset of the owning tree */
+};
+
+struct art_olc_node4 {
+	struct art_olc_header h;
+	uint8_t keys[4];
+	uint8_t bitmap;			/* occupied slots */
+	uint64_t children[4];
+};
+
+struct art_olc_node16 {
+	struct art_olc_header h;
+	uint8_t keys[16];
+	uint16_t bitmap;		/* occupied slots */
+	uint64_t children[16];
+};
+
+struct art_olc_node48 {
+	struct art_olc_header h;
+	uint8_t index[256];		/* slot of the child + 1, 0 if none */
+	uint64_t count;			/* number of children */
+	uint64_t children[48];
+};
+
+struct art_olc_node256 {
+	struct art_olc_header h;
+	uint64_t count;			/* number of children */
+	uint64_t children[256];
+};
+
+struct art_olc_leaf {
+	uint64_t value;			/* offset of the value */
+	uint64_t map;			/* offset of the owning tree */
+	uint32_t key_len;
+	uint8_t key[];
+};
+
+struct art_olc {
+	uint64_t root;			/* reference of the root */
+};
+
+/* DRAM image of a node which is about to be allocated */
+union art_olc_image {
+	struct art_olc_header h;
+	struct art_olc_node4 n4;
+	struct art_olc_node16 n16;
+	struct art_olc_node48 n48;
+	struct art_olc_node256 n256;
+};
+
+static const size_t art_olc_node_size[MAX_ART_OLC_NODE] = {
+	sizeof(struct art_olc_node4),
+	sizeof(struct art_olc_node16),
+	sizeof(struct art_olc_node48),
+	sizeof(struct art_olc_node256),
+};
+
+/* number of children a node can hold */
+static const unsigned art_olc_node_max[MAX_ART_OLC_NODE] = {4, 16, 48, 256};
+
+/* number of children at which a node is replaced by a smaller one */
+static const unsigned art_olc_node_min[MAX_ART_OLC_NODE] = {1, 3, 12, 37};
+
+/* version of a node read optimistically */
+struct art_olc_lock {
+	uint64_t *version;
+	uint64_t v;
+};
+
+/* memory waiting for the concurrent operations to finish */
+struct art_olc_retired {
+	struct art_olc_retired *next;
+	uint64_t off;
+};
+
+/* volatile state of a tree */
+struct art_olc_state {
+	struct art_olc_state *next;
+	uint64_t pool_uuid_lo;
+	uint64_t off;
+
+	uint64_t count;		/* number of leaves */
+	uint64_t active;	/* number of operations in progress */
+	struct art_olc_retired *retired;
+
+	/* versions of the nodes, the lowest bit set when locked */
+	uint64_t versions[ART_OLC_VERSIONS];
+};
+
+static struct art_olc_state *art_olc_states;
+static pthread_mutex_t art_olc_states_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * art_olc_version -- (internal) returns the version counter of a node
+ */
+static uint64_t *
+art_olc_version(struct art_olc_state *s, uint64_t off)
+{
+	uint64_t h = (off >> 4) * 0x9E3779B97F4A7C15ULL;
+
+	return &s->versions[h >> (64 - ART_OLC_VERSIONS_SHIFT)];
+}
+
+/*
+ * art_olc_read_lock -- (internal) reads the version of a node, fails if the
+ * node is locked
+ */
+static int
+art_olc_read_lock(struct art_olc_lock *l)
+{
+	l->v = __atomic_load_n(l->version, __ATOMIC_ACQUIRE);
+
+	return !(l->v & 1);
+}
+
+/*
+ * art_olc_validate -- (internal) checks that the node has not been modified
+ * since its version was read
+ */
+static int
+art_olc_validate(const struct art_olc_lock *l)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return __atomic_load_n(l->version, __ATOMIC_RELAXED) == l->v;
+}
+
+/*
+ * art_olc_shared -- (internal) returns the earlier lock of the set which
+ * uses the same counter, if any
+ */
+static struct art_olc_lock *
+art_olc_shared(struct art_olc_lock *locks, int i)
+{
+	for (int j = 0; j < i; ++j)
+		if (locks[j].version == locks[i].version)
+			return &locks[j];
+
+	return NULL;
+}
+
+/*
+ * art_olc_unlock -- (internal) releases a set of locks, bumping the versions
+ */
+static void
+art_olc_unlock(struct art_olc_lock *locks, int n)
+{
+	for (int i = 0; i < n; ++i)
+		if (art_olc_shared(locks, i) == NULL)
+			__atomic_add_fetch(locks[i].version, 1,
+					__ATOMIC_RELEASE);
+}
+
+/*
+ * art_olc_upgrade -- (internal) turns a set of versions read before into
+ * locks, fails if any of the nodes has been modified since
+ */
+static int
+art_olc_upgrade(struct art_olc_lock *locks, int n)
+{
+	int i;
+	for (i = 0; i < n; ++i) {
+		struct art_olc_lock *l = art_olc_shared(locks, i);
+		if (l != NULL) {
+			if (l->v != locks[i].v)
+				goto err;
+			continue;
+		}
+
+		if (!__sync_bool_compare_and_swap(locks[i].version,
+				locks[i].v, locks[i].v + 1))
+			goto err;
+	}
+
+	return 1;
+
+err:
+	art_olc_unlock(locks, i);
+	return 0;
+}
+
+/*
+ * art_olc_pause -- (internal) backs off before an operation is restarted
+ */
+static void
+art_olc_pause(void)
+{
+	_mm_pause();
+}
+
+/*
+ * art_olc_free -- (internal) frees an unreachable node or leaf
+ */
+static void
+art_olc_free(struct art_olc_state *s, uint64_t ref)
+{
+	PMEMoid oid = {s->pool_uuid_lo, REF_OFF(ref)};
+	pmemobj_free(&oid);
+}
+
+/*
+ * art_olc_reclaim -- (internal) frees the retired memory
+ */
+static void
+art_olc_reclaim(struct art_olc_state *s, struct art_olc_retired *r)
+{
+	while (r != NULL) {
+		struct art_olc_retired *next = r->next;
+		art_olc_free(s, r->off);
+		free(r);
+		r = next;
+	}
+}
+
+/*
+ * art_olc_push -- (internal) adds a list of retired memory to the tree
+ */
+static void
+art_olc_push(struct art_olc_state *s, struct art_olc_retired *first,
+	struct art_olc_retired *last)
+{
+	do {
+		last->next = __atomic_load_n(&s->retired, __ATOMIC_ACQUIRE);
+	} while (!__sync_bool_compare_and_swap(&s->retired, last->next, first));
+}
+
+/*
+ * art_olc_retire -- (internal) frees an unlinked node or leaf as soon as no
+ * other operation can hold a reference to it
+ */
+static void
+art_olc_retire(struct art_olc_state *s, uint64_t ref)
+{
+	/* on failure the object is freed by the recovery */
+	struct art_olc_retired *r = malloc(sizeof(*r));
+	if (r == NULL)
+		return;
+
+	r->off = REF_OFF(ref);
+	art_olc_push(s, r, r);
+}
+
+/*
+ * art_olc_enter -- (internal) registers an operation in progress
+ */
+static void
+art_olc_enter(struct art_olc_state *s)
+{
+	__sync_fetch_and_add(&s->active, 1);
+}
+
+/*
+ * art_olc_exit -- (internal) finishes an operation, reclaims the retired
+ * memory if it is the only one in progress
+ */
+static void
+art_olc_exit(struct art_olc_state *s)
+{
+	struct art_olc_retired *r = NULL;
+	if (__atomic_load_n(&s->retired, __ATOMIC_ACQUIRE) != NULL)
+		r = __atomic_exchange_n(&s->retired, NULL, __ATOMIC_SEQ_CST);
+
+	if (r != NULL) {
+		/*
+		 * Everything on the list was unlinked before, so only the
+		 * operations which are still in progress could have seen it.
+		 */
+		if (__atomic_load_n(&s->active, __ATOMIC_SEQ_CST) == 1) {
+			art_olc_reclaim(s, r);
+		} else {
+			struct art_olc_retired *last = r;
+			while (last->next != NULL)
+				last = last->next;
+			art_olc_push(s, r, last);
+		}
+	}
+
+	__sync_fetch_and_sub(&s->active, 1);
+}
+
+/*
+ * art_olc_key_encode -- (internal) stores an integer key as bytes, in the
+ * order preserving byte-wise comparison
+ */
+static void
+art_olc_key_encode(uint64_t key, uint8_t *buf)
+{
+	for (int i = 7; i >= 0; --i) {
+		buf[i] = (uint8_t)key;
+		key >>= 8;
+	}
+}
+
+/*
+ * art_olc_key_decode -- (internal) reads an integer key stored as bytes
+ */
+static uint64_t
+art_olc_key_decode(const uint8_t *buf)
+{
+	uint64_t key = 0;
+	for (int i = 0; i < 8; ++i)
+		key = (key << 8) | buf[i];
+
+	return key;
+}
+
+/*
+ * art_olc_key_cmp -- (internal) compares two keys byte-wise
+ */
+static int
+art_olc_key_cmp(const uint8_t *k1, uint32_t l1, const uint8_t *k2,
+	uint32_t l2)
+{
+	int ret = memcmp(k1, k2, l1 < l2 ? l1 : l2);
+	if (ret != 0)
+		return ret;
+
+	return l1 < l2 ? -1 : l1 > l2;
+}
+
+/*
+ * art_olc_leaf_matches -- (internal) checks whether the leaf holds the key
+ */
+static int
+art_olc_leaf_matches(struct art_olc_leaf *e, const uint8_t *key,
+	uint32_t len)
+{
+	return e->key_len == len && memcmp(e->key, key, len) == 0;
+}
+
+/*
+ * art_olc_value -- (internal) returns the value stored in a leaf
+ */
+static PMEMoid
+art_olc_value(struct art_olc_state *s, struct art_olc_leaf *e)
+{
+	PMEMoid value = OID_NULL;
+	uint64_t off = LOAD(e->value);
+	if (off != 0) {
+		value.pool_uuid_lo = s->pool_uuid_lo;
+		value.off = off;
+	}
+
+	return value;
+}
+
+/*
+ * art_olc_publish -- (internal) stores and persists a reference
+ */
+static void
+art_olc_publish(PMEMobjpool *pop, uint64_t *slot, uint64_t ref)
+{
+	PM_EQU(*slot, ref);
+	pmemobj_persist(pop, slot, sizeof(*slot));
+}
+
+/*
+ * art_olc_find_child -- (internal) returns the slot of the child under the
+ * given byte, the slot may hold 0 in a Node256
+ */
+static uint64_t *
+art_olc_find_child(struct art_olc_header *h, uint8_t c)
+{
+	switch (h->type) {
+	case ART_OLC_NODE4: {
+		struct art_olc_node4 *n = (struct art_olc_node4 *)h;
+		unsigned bitmap = LOAD(n->bitmap);
+		for (int i = 0; i < 4; ++i)
+			if ((bitmap & (1u << i)) && n->keys[i] == c)
+				return &n->children[i];
+		return NULL;
+	}
+	case ART_OLC_NODE16: {
+		struct art_olc_node16 *n = (struct art_olc_node16 *)h;
+		unsigned bitmap = LOAD(n->bitmap);
+		__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char)c),
+			_mm_loadu_si128((__m128i *)n->keys));
+		unsigned mask = (unsigned)_mm_movemask_epi8(cmp) & bitmap;
+		return mask ? &n->children[__builtin_ctz(mask)] : NULL;
+	}
+	case ART_OLC_NODE48: {
+		struct art_olc_node48 *n = (struct art_olc_node48 *)h;
+		unsigned i = LOAD(n->index[c]);
+		return i ? &n->children[i - 1] : NULL;
+	}
+	case ART_OLC_NODE256: {
+		struct art_olc_node256 *n = (struct art_olc_node256 *)h;
+		return &n->children[c];
+	}
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * art_olc_next_child -- (internal) returns the lowest byte not lower than c
+ * under which the node has a child, -1 if there is none
+ */
+static int
+art_olc_next_child(struct art_olc_header *h, int c, uint64_t *ref)
+{
+	int best = -1;
+
+	switch (h->type) {
+	case ART_OLC_NODE4: {
+		struct art_olc_node4 *n = (struct art_olc_node4 *)h;
+		unsigned bitmap = LOAD(n->bitmap);
+		for (int i = 0; i < 4; ++i) {
+			int k = n->keys[i];
+			if (!(bitmap & (1u << i)) || k < c ||
+					(best >= 0 && k > best))
+				continue;
+			best = k;
+			*ref = LOAD(n->children[i]);
+		}
+		break;
+	}
+	case ART_OLC_NODE16: {
+		if (c > UINT8_MAX)
+			break;
+		struct art_olc_node16 *n = (struct art_olc_node16 *)h;
+		__m128i keys = _mm_loadu_si128((__m128i *)n->keys);
+		__m128i ge = _mm_cmpeq_epi8(
+			_mm_max_epu8(keys, _mm_set1_epi8((char)c)), keys);
+		unsigned mask = (unsigned)_mm_movemask_epi8(ge) &
+			LOAD(n->bitmap);
+		while (mask) {
+			int i = __builtin_ctz(mask);
+			mask &= mask - 1;
+			int k = n->keys[i];
+			if (best >= 0 && k > best)
+				continue;
+			best = k;
+			*ref = LOAD(n->children[i]);
+		}
+		break;
+	}
+	case ART_OLC_NODE48: {
+		struct art_olc_node48 *n = (struct art_olc_node48 *)h;
+		for (int k = c; k <= UINT8_MAX; ++k) {
+			unsigned i = LOAD(n->index[k]);
+			if (i == 0)
+				continue;
+			uint64_t r = LOAD(n->children[i - 1]);
+			if (r != 0) {
+				*ref = r;
+				return k;
+			}
+		}
+		break;
+	}
+	case ART_OLC_NODE256: {
+		struct art_olc_node256 *n = (struct art_olc_node256 *)h;
+		for (int k = c; k <= UINT8_MAX; ++k) {
+			uint64_t r = LOAD(n->children[k]);
+			if (r != 0) {
+				*ref = r;
+				return k;
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	return best;
+}
+
+/*
+ * art_olc_nchildren -- (internal) returns the number of children of a node
+ */
+static unsigned
+art_olc_nchildren(struct art_olc_header *h)
+{
+	switch (h->type) {
+	case ART_OLC_NODE4:
+		return (unsigned)__builtin_popcount(
+			LOAD(((struct art_olc_node4 *)h)->bitmap));
+	case ART_OLC_NODE16:
+		return (unsigned)__builtin_popcount(
+			LOAD(((struct art_olc_node16 *)h)->bitmap));
+	case ART_OLC_NODE48:
+		return (unsigned)LOAD(((struct art_olc_node48 *)h)->count);
+	case ART_OLC_NODE256:
+		return (unsigned)LOAD(((struct art_olc_node256 *)h)->count);
+	default:
+		return 0;
+	}
+}
+
+/*
+ * art_olc_node_add -- (internal) adds a child to a locked node which is not
+ * full
+ */
+static void
+art_olc_node_add(PMEMobjpool *pop, struct art_olc_header *h, uint8_t c,
+	uint64_t ref)
+{
+	switch (h->type) {
+	case ART_OLC_NODE4: {
+		struct art_olc_node4 *n = (struct art_olc_node4 *)h;
+		int i = __builtin_ctz(~(unsigned)n->bitmap);
+		PM_EQU(n->keys[i], c);
+		PM_EQU(n->children[i], ref);
+		pmemobj_persist(pop, &n->keys[i], sizeof(n->keys[i]));
+		pmemobj_persist(pop, &n->children[i], sizeof(n->children[i]));
+
+		/* setting the bit publishes the child */
+		PM_EQU(n->bitmap, (uint8_t)(n->bitmap | (1u << i)));
+		pmemobj_persist(pop, &n->bitmap, sizeof(n->bitmap));
+		break;
+	}
+	case ART_OLC_NODE16: {
+		struct art_olc_node16 *n = (struct art_olc_node16 *)h;
+		int i = __builtin_ctz(~(unsigned)n->bitmap);
+		PM_EQU(n->keys[i], c);
+		PM_EQU(n->children[i], ref);
+		pmemobj_persist(pop, &n->keys[i], sizeof(n->keys[i]));
+		pmemobj_persist(pop, &n->children[i], sizeof(n->children[i]));
+
+		PM_EQU(n->bitmap, (uint16_t)(n->bitmap | (1u << i)));
+		pmemobj_persist(pop, &n->bitmap, sizeof(n->bitmap));
+		break;
+	}
+	case ART_OLC_NODE48: {
+		struct art_olc_node48 *n = (struct art_olc_node48 *)h;
+		int i = 0;
+		while (n->children[i] != 0)
+			++i;
+		art_olc_publish(pop, &n->children[i], ref);
+
+		/* the index entry publishes the child */
+		PM_EQU(n->index[c], (uint8_t)(i + 1));
+		pmemobj_persist(pop, &n->index[c], sizeof(n->index[c]));
+		art_olc_publish(pop, &n->count, n->count + 1);
+		break;
+	}
+	case ART_OLC_NODE256: {
+		struct art_olc_node256 *n = (struct art_olc_node256 *)h;
+		art_olc_publish(pop, &n->children[c], ref);
+		art_olc_publish(pop, &n->count, n->count + 1);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+/*
+ * art_olc_node_remove -- (internal) removes a child from a locked node
+ */
+static void
+art_olc_node_remove(PMEMobjpool *pop, struct art_olc_header *h, uint8_t c)
+{
+	switch (h->type) {
+	case ART_OLC_NODE4: {
+		struct art_olc_node4 *n = (struct art_olc_node4 *)h;
+		long i = art_olc_find_child(h, c) - n->children;
+		PM_EQU(n->bitmap, (uint8_t)(n->bitmap & ~(1u << i)));
+		pmemobj_persist(pop, &n->bitmap, sizeof(n->bitmap));
+		break;
+	}
+	case ART_OLC_NODE16: {
+		struct art_olc_node16 *n = (struct art_olc_node16 *)h;
+		long i = art_olc_find_child(h, c) - n->children;
+		PM_EQU(n->bitmap, (uint16_t)(n->bitmap & ~(1u << i)));
+		pmemobj_persist(pop, &n->bitmap, sizeof(n->bitmap));
+		break;
+	}
+	case ART_OLC_NODE48: {
+		struct art_olc_node48 *n = (struct art_olc_node48 *)h;
+		int i = n->index[c] - 1;
+		PM_EQU(n->index[c], 0);
+		pmemobj_persist(pop, &n->index[c], sizeof(n->index[c]));
+
+		/* an orphaned slot is cleared by the recovery */
+		art_olc_publish(pop, &n->children[i], 0);
+		art_olc_publish(pop, &n->count, n->count - 1);
+		break;
+	}
+	case ART_OLC_NODE256: {
+		struct art_olc_node256 *n = (struct art_olc_node256 *)h;
+		art_olc_publish(pop, &n->children[c], 0);
+		art_olc_publish(pop, &n->count, n->count - 1);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+/*
+ * art_olc_image_init -- (internal) prepares the image of an empty node
+ */
+static void
+art_olc_image_init(union art_olc_image *img, int type, uint32_t prefix_len,
+	const uint8_t *prefix, uint64_t map)
+{
+	memset(img, 0, art_olc_node_size[type]);
+	img->h.type = (uint8_t)type;
+	img->h.prefix_len = prefix_len;
+	memcpy(img->h.prefix, prefix,
+		prefix_len < ART_OLC_PREFIX ? prefix_len : ART_OLC_PREFIX);
+	img->h.map = map;
+}
+
+/*
+ * art_olc_image_add -- (internal) adds a child to the image of a node
+ */
+static void
+art_olc_image_add(union art_olc_image *img, uint8_t c, uint64_t ref)
+{
+	int i = 0;
+
+	switch (img->h.type) {
+	case ART_OLC_NODE4:
+		i = __builtin_ctz(~(unsigned)img->n4.bitmap);
+		img->n4.keys[i] = c;
+		img->n4.children[i] = ref;
+		img->n4.bitmap |= (uint8_t)(1u << i);
+		break;
+	case ART_OLC_NODE16:
+		i = __builtin_ctz(~(unsigned)img->n16.bitmap);
+		img->n16.keys[i] = c;
+		img->n16.children[i] = ref;
+		img->n16.bitmap |= (uint16_t)(1u << i);
+		break;
+	case ART_OLC_NODE48:
+		while (img->n48.children[i] != 0)
+			++i;
+		img->n48.children[i] = ref;
+		img->n48.index[c] = (uint8_t)(i + 1);
+		img->n48.count++;
+		break;
+	case ART_OLC_NODE256:
+		img->n256.children[c] = ref;
+		img->n256.count++;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * art_olc_image_copy -- (internal) copies the children of a locked node to
+ * the image, except the one under the given byte
+ */
+static void
+art_olc_image_copy(union art_olc_image *img, struct art_olc_header *h,
+	int skip)
+{
+	uint64_t ref;
+	for (int c = 0; (c = art_olc_next_child(h, c, &ref)) >= 0; ++c)
+		if (c != skip)
+			art_olc_image_add(img, (uint8_t)c, ref);
+}
+
+struct art_olc_image_args {
+	const void *image;
+	size_t size;
+};
+
+/*
+ * art_olc_node_create -- (internal) constructor of a node
+ */
+static int
+art_olc_node_create(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	struct art_olc_image_args *args = arg;
+	pmemobj_memcpy_persist(pop, ptr, args->image, args->size);
+
+	return 0;
+}
+
+/*
+ * art_olc_node_alloc -- (internal) allocates a node initialized with the
+ * image, returns its offset or 0 on failure
+ */
+static uint64_t
+art_olc_node_alloc(PMEMobjpool *pop, const union art_olc_image *img)
+{
+	struct art_olc_image_args args = {
+		img, art_olc_node_size[img->h.type]
+	};
+
+	PMEMoid oid;
+	if (pmemobj_alloc(pop, &oid, args.size,
+			TOID_TYPE_NUM(struct art_olc_node4) + img->h.type,
+			art_olc_node_create, &args))
+		return 0;
+
+	return oid.off;
+}
+
+struct art_olc_leaf_args {
+	uint64_t value;
+	uint64_t map;
+	const uint8_t *key;
+	uint32_t key_len;
+};
+
+/*
+ * art_olc_leaf_create -- (internal) constructor of a leaf
+ */
+static int
+art_olc_leaf_create(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	struct art_olc_leaf *e = ptr;
+	struct art_olc_leaf_args *args = arg;
+
+	PM_EQU(e->value, args->value);
+	PM_EQU(e->map, args->map);
+	PM_EQU(e->key_len, args->key_len);
+	pmemobj_persist(pop, e, sizeof(*e));
+	pmemobj_memcpy_persist(pop, e->key, args->key, args->key_len);
+
+	return 0;
+}
+
+/*
+ * art_olc_leaf_alloc -- (internal) allocates a leaf, returns its reference
+ * or 0 on failure
+ */
+static uint64_t
+art_olc_leaf_alloc(PMEMobjpool *pop, struct art_olc_leaf_args *args)
+{
+	PMEMoid oid;
+	if (pmemobj_alloc(pop, &oid,
+			sizeof(struct art_olc_leaf) + args->key_len,
+			TOID_TYPE_NUM(struct art_olc_leaf),
+			art_olc_leaf_create, args))
+		return 0;
+
+	return oid.off | ART_OLC_LEAF;
+}
+
+/*
+ * art_olc_leaf_min -- (internal) returns the leftmost leaf below the
+ * reference, 0 if a concurrent change got in the way
+ */
+static uint64_t
+art_olc_leaf_min(PMEMobjpool *pop, uint64_t ref)
+{
+	while (ref != 0 && !IS_LEAF(ref))
+		if (art_olc_next_child(NODE(pop, ref), 0, &ref) < 0)
+			return 0;
+
+	return ref;
+}
+
+/*
+ * art_olc_prefix -- (internal) returns the whole compressed path of a node
+ * at the given depth, the bytes which do not fit into the node are taken
+ * from any leaf below it
+ */
+static const uint8_t *
+art_olc_prefix(PMEMobjpool *pop, struct art_olc_header *h, uint32_t depth)
+{
+	if (h->prefix_len <= ART_OLC_PREFIX)
+		return h->prefix;
+
+	uint64_t ref = art_olc_leaf_min(pop, (uintptr_t)h - (uintptr_t)pop);
+	if (ref == 0)
+		return NULL;
+
+	struct art_olc_leaf *e = LEAF(pop, ref);
+	if (e->key_len < depth + h->prefix_len)
+		return NULL;
+
+	return e->key + depth;
+}
+
+/*
+ * art_olc_prefix_match -- (internal) returns the number of leading bytes of
+ * the compressed path which match the key, -1 on a conflict
+ */
+static int
+art_olc_prefix_match(PMEMobjpool *pop, struct art_olc_header *h,
+	const uint8_t *key, uint32_t len, uint32_t depth)
+{
+	const uint8_t *p = art_olc_prefix(pop, h, depth);
+	if (p == NULL)
+		return -1;
+
+	uint32_t i;
+	for (i = 0; i < h->prefix_len && depth + i < len; ++i)
+		if (p[i] != key[depth + i])
+			break;
+
+	return (int)i;
+}
+
+/*
+ * art_olc_insert_key -- (internal) inserts or updates a key
+ */
+static int
+art_olc_insert_key(PMEMobjpool *pop, struct art_olc_state *s,
+	const uint8_t *key, uint32_t len, uint64_t value)
+{
+	struct art_olc *t = (struct art_olc *)((uintptr_t)pop + s->off);
+	struct art_olc_leaf_args args = {value, s->off, key, len};
+	union art_olc_image img;
+	union art_olc_image copy;
+	struct art_olc_lock l[2]; /* the parent and the node */
+	uint64_t leaf = 0;
+	uint64_t *slot;
+	uint64_t ref;
+	uint64_t n;
+	uint32_t depth;
+	int ret = 0;
+
+	goto start;
+restart:
+	art_olc_pause();
+start:
+	l[0].version = art_olc_version(s, s->off);
+	if (!art_olc_read_lock(&l[0]))
+		goto restart;
+
+	slot = &t->root;
+	ref = LOAD(*slot);
+	if (!art_olc_validate(&l[0]))
+		goto restart;
+
+	depth = 0;
+	for (;;) {
+		if (ref == 0 || IS_LEAF(ref)) {
+			struct art_olc_leaf *e = ref ? LEAF(pop, ref) : NULL;
+			if (e != NULL && art_olc_leaf_matches(e, key, len)) {
+				/* the key exists, replace the value */
+				if (!art_olc_upgrade(&l[0], 1))
+					goto restart;
+				art_olc_publish(pop, &e->value, value);
+				art_olc_unlock(&l[0], 1);
+				goto out;
+			}
+
+			uint32_t i = depth;
+			if (e != NULL) {
+				while (i < len && i < e->key_len &&
+						key[i] == e->key[i])
+					++i;
+				if (i == len || i == e->key_len) {
+					/* one key is a prefix of the other */
+					errno = EINVAL;
+					ret = 1;
+					goto out;
+				}
+			}
+
+			if (leaf == 0 &&
+				(leaf = art_olc_leaf_alloc(pop, &args)) == 0) {
+				ret = 1;
+				goto out;
+			}
+
+			if (!art_olc_upgrade(&l[0], 1))
+				goto restart;
+
+			if (e == NULL) {
+				art_olc_publish(pop, slot, leaf);
+			} else {
+				/* replace the leaf with a node holding both */
+				art_olc_image_init(&img, ART_OLC_NODE4,
+					i - depth, key + depth, s->off);
+				art_olc_image_add(&img, key[i], leaf);
+				art_olc_image_add(&img, e->key[i], ref);
+				if ((n = art_olc_node_alloc(pop, &img)) == 0) {
+					art_olc_unlock(&l[0], 1);
+					ret = 1;
+					goto out;
+				}
+				art_olc_publish(pop, slot, n);
+			}
+
+			art_olc_unlock(&l[0], 1);
+			break;
+		}
+
+		struct art_olc_header *h = NODE(pop, ref);
+		l[1].version = art_olc_version(s, ref);
+		if (!art_olc_read_lock(&l[1]) || !art_olc_validate(&l[0]))
+			goto restart;
+
+		int m = art_olc_prefix_match(pop, h, key, len, depth);
+		if (m < 0 || !art_olc_validate(&l[1]))
+			goto restart;
+
+		if ((uint32_t)m < h->prefix_len) {
+			if (depth + (uint32_t)m == len) {
+				errno = EINVAL;
+				ret = 1;
+				goto out;
+			}
+
+			if (leaf == 0 &&
+				(leaf = art_olc_leaf_alloc(pop, &args)) == 0) {
+				ret = 1;
+				goto out;
+			}
+
+			if (!art_olc_upgrade(l, 2))
+				goto restart;
+
+			const uint8_t *p = art_olc_prefix(pop, h, depth);
+			if (p == NULL) {
+				art_olc_unlock(l, 2);
+				goto restart;
+			}
+
+			/*
+			 * Split the compressed path -- the node is copied with
+			 * a shorter one below a new node.
+			 */
+			art_olc_image_init(&copy, h->type,
+				h->prefix_len - (uint32_t)m - 1, p + m + 1,
+				s->off);
+			art_olc_image_copy(&copy, h, -1);
+			art_olc_image_init(&img, ART_OLC_NODE4, (uint32_t)m,
+				p, s->off);
+
+			uint64_t c = art_olc_node_alloc(pop, &copy);
+			if (c == 0) {
+				art_olc_unlock(l, 2);
+				ret = 1;
+				goto out;
+			}
+			art_olc_image_add(&img, p[m], c);
+			art_olc_image_add(&img, key[depth + (uint32_t)m], leaf);
+			if ((n = art_olc_node_alloc(pop, &img)) == 0) {
+				art_olc_unlock(l, 2);
+				art_olc_free(s, c);
+				ret = 1;
+				goto out;
+			}
+
+			art_olc_publish(pop, slot, n);
+			art_olc_unlock(l, 2);
+			art_olc_retire(s, ref);
+			break;
+		}
+
+		depth += h->prefix_len;
+		if (depth >= len) {
+			/* the key is a prefix of the keys below the node */
+			errno = EINVAL;
+			ret = 1;
+			goto out;
+		}
+
+		uint8_t c = key[depth];
+		uint64_t *cslot = art_olc_find_child(h, c);
+		uint64_t next = cslot ? LOAD(*cslot) : 0;
+		unsigned nchildren = art_olc_nchildren(h);
+		if (!art_olc_validate(&l[1]))
+			goto restart;
+
+		if (next != 0) {
+			l[0] = l[1];
+			slot = cslot;
+			ref = next;
+			depth++;
+			continue;
+		}
+
+		if (leaf == 0 && (leaf = art_olc_leaf_alloc(pop, &args)) == 0) {
+			ret = 1;
+			goto out;
+		}
+
+		if (nchildren < art_olc_node_max[h->type]) {
+			if (!art_olc_upgrade(&l[1], 1))
+				goto restart;
+			art_olc_node_add(pop, h, c, leaf);
+			art_olc_unlock(&l[1], 1);
+			break;
+		}
+
+		/* grow the node */
+		if (!art_olc_upgrade(l, 2))
+			goto restart;
+
+		art_olc_image_init(&img, h->type + 1, h->prefix_len, h->prefix,
+			s->off);
+		art_olc_image_copy(&img, h, -1);
+		art_olc_image_add(&img, c, leaf);
+		if ((n = art_olc_node_alloc(pop, &img)) == 0) {
+			art_olc_unlock(l, 2);
+			ret = 1;
+			goto out;
+		}
+
+		art_olc_publish(pop, slot, n);
+		art_olc_unlock(l, 2);
+		art_olc_retire(s, ref);
+		break;
+	}
+
+	/* the new leaf has been published */
+	leaf = 0;
+	__sync_fetch_and_add(&s->count, 1);
+out:
+	if (leaf != 0)
+		art_olc_free(s, leaf);
+
+	return ret;
+}
+
+/*
+ * art_olc_merge_prefix -- (internal) returns the leading bytes of the path
+ * of a node which replaces its parent holding a single child
+ */
+static void
+art_olc_merge_prefix(struct art_olc_header *parent, uint8_t c,
+	struct art_olc_header *h, uint8_t *prefix)
+{
+	uint32_t k = 0;
+	for (uint32_t i = 0; i < parent->prefix_len && k < ART_OLC_PREFIX; ++i)
+		prefix[k++] = parent->prefix[i];
+
+	if (k < ART_OLC_PREFIX)
+		prefix[k++] = c;
+
+	for (uint32_t i = 0; i < h->prefix_len && k < ART_OLC_PREFIX; ++i)
+		prefix[k++] = h->prefix[i];
+}
+
+/*
+ * art_olc_remove_key -- (internal) removes a key, returns 1 and its value if
+ * it was found
+ */
+static int
+art_olc_remove_key(PMEMobjpool *pop, struct art_olc_state *s,
+	const uint8_t *key, uint32_t len, PMEMoid *value)
+{
+	struct art_olc *t = (struct art_olc *)((uintptr_t)pop + s->off);
+	union art_olc_image img;
+	struct art_olc_lock l[3]; /* the parent, the node and its child */
+	uint64_t *slot;
+	uint64_t ref;
+	uint64_t n;
+	uint32_t depth;
+
+	goto start;
+restart:
+	art_olc_pause();
+start:
+	l[0].version = art_olc_version(s, s->off);
+	if (!art_olc_read_lock(&l[0]))
+		goto restart;
+
+	slot = &t->root;
+	ref = LOAD(*slot);
+	if (!art_olc_validate(&l[0]))
+		goto restart;
+
+	if (ref == 0)
+		return 0;
+
+	if (IS_LEAF(ref)) {
+		struct art_olc_leaf *e = LEAF(pop, ref);
+		if (!art_olc_leaf_matches(e, key, len))
+			return 0;
+
+		if (!art_olc_upgrade(&l[0], 1))
+			goto restart;
+
+		*value = art_olc_value(s, e);
+		art_olc_publish(pop, slot, 0);
+		art_olc_unlock(&l[0], 1);
+		goto removed;
+	}
+
+	depth = 0;
+	for (;;) {
+		struct art_olc_header *h = NODE(pop, ref);
+		l[1].version = art_olc_version(s, ref);
+		if (!art_olc_read_lock(&l[1]) || !art_olc_validate(&l[0]))
+			goto restart;
+
+		int m = art_olc_prefix_match(pop, h, key, len, depth);
+		if (m < 0 || !art_olc_validate(&l[1]))
+			goto restart;
+
+		if ((uint32_t)m < h->prefix_len)
+			return 0;
+
+		depth += h->prefix_len;
+		if (depth >= len)
+			return 0;
+
+		uint8_t c = key[depth];
+		uint64_t *cslot = art_olc_find_child(h, c);
+		uint64_t next = cslot ? LOAD(*cslot) : 0;
+		unsigned nchildren = art_olc_nchildren(h);
+		if (!art_olc_validate(&l[1]))
+			goto restart;
+
+		if (next == 0)
+			return 0;
+
+		if (!IS_LEAF(next)) {
+			l[0] = l[1];
+			slot = cslot;
+			ref = next;
+			depth++;
+			continue;
+		}
+
+		struct art_olc_leaf *e = LEAF(pop, next);
+		if (!art_olc_leaf_matches(e, key, len))
+			return 0;
+
+		if (nchildren - 1 > art_olc_node_min[h->type]) {
+			if (!art_olc_upgrade(&l[1], 1))
+				goto restart;
+			*value = art_olc_value(s, e);
+			art_olc_node_remove(pop, h, c);
+			art_olc_unlock(&l[1], 1);
+			ref = next;
+			goto removed;
+		}
+
+		if (h->type != ART_OLC_NODE4) {
+			/* shrink the node */
+			if (!art_olc_upgrade(l, 2))
+				goto restart;
+
+			art_olc_image_init(&img, h->type - 1, h->prefix_len,
+				h->prefix, s->off);
+			art_olc_image_copy(&img, h, c);
+			if ((n = art_olc_node_alloc(pop, &img)) == 0) {
+				/* removing in place is still correct */
+				art_olc_node_remove(pop, h, c);
+				*value = art_olc_value(s, e);
+				art_olc_unlock(l, 2);
+				ref = next;
+				goto removed;
+			}
+
+			*value = art_olc_value(s, e);
+			art_olc_publish(pop, slot, n);
+			art_olc_unlock(l, 2);
+			art_olc_retire(s, ref);
+			ref = next;
+			goto removed;
+		}
+
+		/* the node is left with a single child, collapse it */
+		uint64_t rest = 0;
+		int b;
+		for (b = 0; (b = art_olc_next_child(h, b, &rest)) >= 0; ++b)
+			if (b != c)
+				break;
+		if (b < 0 || !art_olc_validate(&l[1]))
+			goto restart;
+
+		if (IS_LEAF(rest)) {
+			if (!art_olc_upgrade(l, 2))
+				goto restart;
+			*value = art_olc_value(s, e);
+			art_olc_publish(pop, slot, rest);
+			art_olc_unlock(l, 2);
+			art_olc_retire(s, ref);
+			ref = next;
+			goto removed;
+		}
+
+		/* the child takes over the path of the node */
+		struct art_olc_header *ch = NODE(pop, rest);
+		l[2].version = art_olc_version(s, rest);
+		if (!art_olc_read_lock(&l[2]) || !art_olc_validate(&l[1]))
+			goto restart;
+		if (!art_olc_upgrade(l, 3))
+			goto restart;
+
+		uint8_t prefix[ART_OLC_PREFIX];
+		art_olc_merge_prefix(h, (uint8_t)b, ch, prefix);
+		art_olc_image_init(&img, ch->type,
+			h->prefix_len + 1 + ch->prefix_len, prefix, s->off);
+		art_olc_image_copy(&img, ch, -1);
+		if ((n = art_olc_node_alloc(pop, &img)) == 0) {
+			art_olc_unlock(l, 3);
+			return -1;
+		}
+
+		*value = art_olc_value(s, e);
+		art_olc_publish(pop, slot, n);
+		art_olc_unlock(l, 3);
+		art_olc_retire(s, ref);
+		art_olc_retire(s, rest);
+		ref = next;
+		goto removed;
+	}
+
+removed:
+	art_olc_retire(s, ref);
+	__sync_fetch_and_sub(&s->count, 1);
+
+	return 1;
+}
+
+/*
+ * art_olc_get_key -- (internal) searches for a key, returns 1 and its value
+ * if it was found
+ */
+static int
+art_olc_get_key(PMEMobjpool *pop, struct art_olc_state *s,
+	const uint8_t *key, uint32_t len, PMEMoid *value)
+{
+	struct art_olc *t = (struct art_olc *)((uintptr_t)pop + s->off);
+	struct art_olc_lock l[2];
+	uint64_t ref;
+	uint32_t depth;
+
+	goto start;
+restart:
+	art_olc_pause();
+start:
+	l[0].version = art_olc_version(s, s->off);
+	if (!art_olc_read_lock(&l[0]))
+		goto restart;
+
+	ref = LOAD(t->root);
+	if (!art_olc_validate(&l[0]))
+		goto restart;
+
+	depth = 0;
+	for (;;) {
+		if (ref == 0)
+			return 0;
+
+		if (IS_LEAF(ref)) {
+			struct art_olc_leaf *e = LEAF(pop, ref);
+			if (!art_olc_leaf_matches(e, key, len))
+				return 0;
+
+			/* the value is replaced with the parent locked */
+			*value = art_olc_value(s, e);
+			if (!art_olc_validate(&l[0]))
+				goto restart;
+
+			return 1;
+		}
+
+		struct art_olc_header *h = NODE(pop, ref);
+		l[1].version = art_olc_version(s, ref);
+		if (!art_olc_read_lock(&l[1]) || !art_olc_validate(&l[0]))
+			goto restart;
+
+		int m = art_olc_prefix_match(pop, h, key, len, depth);
+		if (m < 0)
+			goto restart;
+
+		depth += h->prefix_len;
+		if ((uint32_t)m < h->prefix_len || depth >= len) {
+			if (!art_olc_validate(&l[1]))
+				goto restart;
+			return 0;
+		}
+
+		uint64_t *cslot = art_olc_find_child(h, key[depth]);
+		ref = cslot ? LOAD(*cslot) : 0;
+		if (!art_olc_validate(&l[1]))
+			goto restart;
+
+		l[0] = l[1];
+		depth++;
+	}
+}
+
+/*
+ * art_olc_min -- (internal) finds the leftmost leaf below the reference,
+ * returns 1 if found, 0 if there is none and -1 on a conflict
+ */
+static int
+art_olc_min(PMEMobjpool *pop, struct art_olc_state *s,
+	const struct art_olc_lock *parent, uint64_t ref, uint64_t *leaf)
+{
+	struct art_olc_lock l[2];
+	l[0] = *parent;
+
+	while (!IS_LEAF(ref)) {
+		l[1].version = art_olc_version(s, ref);
+		if (!art_olc_read_lock(&l[1]) || !art_olc_validate(&l[0]))
+			return -1;
+
+		if (art_olc_next_child(NODE(pop, ref), 0, &ref) < 0 ||
+				!art_olc_validate(&l[1]))
+			return -1;
+
+		l[0] = l[1];
+	}
+
+	*leaf = ref;
+	return 1;
+}
+
+/*
+ * art_olc_lower_bound -- (internal) finds the leaf with the lowest key not
+ * lower than the given one below the reference, returns 1 if found, 0 if
+ * there is none and -1 on a conflict
+ */
+static int
+art_olc_lower_bound(PMEMobjpool *pop, struct art_olc_state *s,
+	const struct art_olc_lock *parent, uint64_t ref,
+	const uint8_t *key, uint32_t len, uint32_t depth, uint64_t *leaf)
+{
+	if (IS_LEAF(ref)) {
+		struct art_olc_leaf *e = LEAF(pop, ref);
+		if (art_olc_key_cmp(e->key, e->key_len, key, len) < 0)
+			return 0;
+
+		*leaf = ref;
+		return 1;
+	}
+
+	struct art_olc_header *h = NODE(pop, ref);
+	struct art_olc_lock l = {art_olc_version(s, ref), 0};
+	if (!art_olc_read_lock(&l) || !art_olc_validate(parent))
+		return -1;
+
+	const uint8_t *p = art_olc_prefix(pop, h, depth);
+	if (p == NULL)
+		return -1;
+
+	for (uint32_t i = 0; i < h->prefix_len; ++i) {
+		/* all keys below are greater */
+		if (depth + i == len || p[i] > key[depth + i])
+			return art_olc_min(pop, s, parent, ref, leaf);
+
+		/* all keys below are lower */
+		if (p[i] < key[depth + i])
+			return art_olc_validate(&l) ? 0 : -1;
+	}
+
+	depth += h->prefix_len;
+	if (depth >= len)
+		return art_olc_min(pop, s, parent, ref, leaf);
+
+	uint64_t child;
+	for (int c = key[depth];
+			(c = art_olc_next_child(h, c, &child)) >= 0; ++c) {
+		if (!art_olc_validate(&l))
+			return -1;
+
+		int ret = c == key[depth] ?
+			art_olc_lower_bound(pop, s, &l, child,
+				key, len, depth + 1, leaf) :
+			art_olc_min(pop, s, &l, child, leaf);
+		if (ret != 0)
+			return ret;
+	}
+
+	return art_olc_validate(&l) ? 0 : -1;
+}
+
+/*
+ * art_olc_seek -- (internal) finds the leaf with the lowest key not lower
+ * than the given one, returns 0 if there is none
+ */
+static int
+art_olc_seek(PMEMobjpool *pop, struct art_olc_state *s,
+	const uint8_t *key, uint32_t len, uint64_t *leaf)
+{
+	struct art_olc *t = (struct art_olc *)((uintptr_t)pop + s->off);
+	struct art_olc_lock l = {art_olc_version(s, s->off), 0};
+
+	for (;; art_olc_pause()) {
+		if (!art_olc_read_lock(&l))
+			continue;
+
+		uint64_t ref = LOAD(t->root);
+		if (!art_olc_validate(&l))
+			continue;
+
+		if (ref == 0)
+			return 0;
+
+		int ret = art_olc_lower_bound(pop, s, &l, ref, key, len, 0,
+				leaf);
+		if (ret >= 0)
+			return ret;
+	}
+}
+
+/* offsets of the reachable nodes and leaves */
+struct art_olc_live {
+	uint64_t *offs;
+	size_t n;
+	size_t size;
+};
+
+/*
+ * art_olc_offset_cmp -- (internal) compares two pool offsets
+ */
+static int
+art_olc_offset_cmp(const void *lhs, const void *rhs)
+{
+	uint64_t l = *(const uint64_t *)lhs;
+	uint64_t r = *(const uint64_t *)rhs;
+
+	return l < r ? -1 : l > r;
+}
+
+/*
+ * art_olc_rebuild -- (internal) walks the tree after it is opened, clears
+ * the slots of a Node48 orphaned by an interrupted removal, recounts the
+ * children and collects the reachable objects
+ */
+static int
+art_olc_rebuild(PMEMobjpool *pop, struct art_olc_state *s, uint64_t ref,
+	struct art_olc_live *live)
+{
+	if (live->n == live->size) {
+		live->size = live->size ? live->size * 2 : 64;
+		uint64_t *tmp = realloc(live->offs,
+				live->size * sizeof(*live->offs));
+		if (tmp == NULL)
+			return 1;
+		live->offs = tmp;
+	}
+	live->offs[live->n++] = REF_OFF(ref);
+
+	if (IS_LEAF(ref)) {
+		s->count++;
+		return 0;
+	}
+
+	struct art_olc_header *h = NODE(pop, ref);
+	if (h->type == ART_OLC_NODE48) {
+		struct art_olc_node48 *n = (struct art_olc_node48 *)h;
+		int used[48] = {0};
+		for (int c = 0; c <= UINT8_MAX; ++c)
+			if (n->index[c] != 0)
+				used[n->index[c] - 1] = 1;
+
+		for (int i = 0; i < 48; ++i)
+			if (!used[i] && n->children[i] != 0)
+				art_olc_publish(pop, &n->children[i], 0);
+	}
+
+	uint64_t count = 0;
+	uint64_t child;
+	for (int c = 0; (c = art_olc_next_child(h, c, &child)) >= 0; ++c) {
+		count++;
+		if (art_olc_rebuild(pop, s, child, live))
+			return 1;
+	}
+
+	if (h->type == ART_OLC_NODE48) {
+		struct art_olc_node48 *n = (struct art_olc_node48 *)h;
+		if (n->count != count)
+			art_olc_publish(pop, &n->count, count);
+	} else if (h->type == ART_OLC_NODE256) {
+		struct art_olc_node256 *n = (struct art_olc_node256 *)h;
+		if (n->count != count)
+			art_olc_publish(pop, &n->count, count);
+	}
+
+	return 0;
+}
+
+/*
+ * art_olc_state_free -- (internal) frees the volatile state of the tree
+ */
+static void
+art_olc_state_free(struct art_olc_state *s)
+{
+	art_olc_reclaim(s, s->retired);
+	free(s);
+}
+
+/*
+ * art_olc_state_new -- (internal) creates the volatile state of the tree,
+ * repairs it and frees the nodes and leaves which were allocated but never
+ * published or replaced but not freed
+ */
+static struct art_olc_state *
+art_olc_state_new(PMEMobjpool *pop, PMEMoid map)
+{
+	struct art_olc *t = pmemobj_direct(map);
+	struct art_olc_state *s = calloc(1, sizeof(*s));
+	if (s == NULL)
+		return NULL;
+
+	s->pool_uuid_lo = map.pool_uuid_lo;
+	s->off = map.off;
+
+	struct art_olc_live live = {NULL, 0, 0};
+	if (t->root != 0 && art_olc_rebuild(pop, s, t->root, &live)) {
+		free(live.offs);
+		free(s);
+		return NULL;
+	}
+
+	qsort(live.offs, live.n, sizeof(*live.offs), art_olc_offset_cmp);
+
+	for (unsigned type = TOID_TYPE_NUM(struct art_olc_node4);
+			type <= TOID_TYPE_NUM(struct art_olc_leaf); ++type) {
+		PMEMoid oid = POBJ_FIRST_TYPE_NUM(pop, type);
+		while (!OID_IS_NULL(oid)) {
+			PMEMoid next = POBJ_NEXT_TYPE_NUM(oid);
+			uint64_t owner =
+				type == TOID_TYPE_NUM(struct art_olc_leaf) ?
+				((struct art_olc_leaf *)
+					pmemobj_direct(oid))->map :
+				((struct art_olc_header *)
+					pmemobj_direct(oid))->map;
+			if (owner == map.off && bsearch(&oid.off, live.offs,
+					live.n, sizeof(*live.offs),
+					art_olc_offset_cmp) == NULL)
+				pmemobj_free(&oid);
+			oid = next;
+		}
+	}
+
+	free(live.offs);
+	return s;
+}
+
+/*
+ * art_olc_state_find -- (internal) looks up the volatile state of the tree
+ */
+static struct art_olc_state *
+art_olc_state_find(PMEMoid map)
+{
+	struct art_olc_state *s =
+		__atomic_load_n(&art_olc_states, __ATOMIC_ACQUIRE);
+
+	for (; s != NULL; s = s->next)
+		if (s->pool_uuid_lo == map.pool_uuid_lo && s->off == map.off)
+			return s;
+
+	return NULL;
+}
+
+/*
+ * art_olc_state_drop -- (internal) frees the volatile state of the tree,
+ * must not be called concurrently with any other operation on the tree
+ */
+static void
+art_olc_state_drop(PMEMoid map)
+{
+	pthread_mutex_lock(&art_olc_states_lock);
+
+	struct art_olc_state **sp = &art_olc_states;
+	while (*sp != NULL) {
+		struct art_olc_state *s = *sp;
+		if (s->pool_uuid_lo == map.pool_uuid_lo && s->off == map.off) {
+			*sp = s->next;
+			art_olc_state_free(s);
+			break;
+		}
+		sp = &s->next;
+	}
+
+	pthread_mutex_unlock(&art_olc_states_lock);
+}
+
+/*
+ * art_olc_state_get -- (internal) returns the volatile state of the tree,
+ * creates it on the first access after the pool is opened
+ */
+static struct art_olc_state *
+art_olc_state_get(PMEMobjpool *pop, PMEMoid map)
+{
+	struct art_olc_state *s = art_olc_state_find(map);
+	if (s != NULL)
+		return s;
+
+	pthread_mutex_lock(&art_olc_states_lock);
+
+	s = art_olc_state_find(map);
+	if (s == NULL) {
+		s = art_olc_state_new(pop, map);
+		if (s != NULL) {
+			s->next = art_olc_states;
+			__atomic_store_n(&art_olc_states, s, __ATOMIC_RELEASE);
+		}
+	}
+
+	pthread_mutex_unlock(&art_olc_states_lock);
+
+	return s;
+}
+
+/*
+ * art_olc_create -- (internal) constructor of the tree
+ */
+static int
+art_olc_create(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	struct art_olc *t = ptr;
+
+	PM_EQU(t->root, 0);
+	pmemobj_persist(pop, t, sizeof(*t));
+
+	return 0;
+}
+
+/*
+ * art_olc_new -- allocates a new tree instance
+ */
+int
+art_olc_new(PMEMobjpool *pop, TOID(struct art_olc) *map, void *arg)
+{
+	return pmemobj_alloc(pop, &map->oid, sizeof(struct art_olc),
+		TOID_TYPE_NUM(struct art_olc), art_olc_create, NULL) != 0;
+}
+
+/*
+ * art_olc_init -- recovers the tree and rebuilds the volatile state, called
+ * after pmemobj_open
+ */
+int
+art_olc_init(PMEMobjpool *pop, TOID(struct art_olc) map)
+{
+	art_olc_state_drop(map.oid);
+
+	return art_olc_state_get(pop, map.oid) == NULL;
+}
+
+/*
+ * art_olc_clear -- removes all elements from the tree
+ */
+int
+art_olc_clear(PMEMobjpool *pop, TOID(struct art_olc) map)
+{
+	struct art_olc_state *s = art_olc_state_get(pop, map.oid);
+	if (s == NULL)
+		return 1;
+
+	int ret = 0;
+	art_olc_enter(s);
+
+	/* the leaves are not freed before this operation exits */
+	uint64_t ref;
+	PMEMoid value;
+	while (art_olc_seek(pop, s, NULL, 0, &ref)) {
+		struct art_olc_leaf *e = LEAF(pop, ref);
+		if (art_olc_remove_key(pop, s, e->key, e->key_len,
+				&value) < 0) {
+			ret = 1;
+			break;
+		}
+	}
+
+	art_olc_exit(s);
+
+	return ret;
+}
+
+/*
+ * art_olc_delete -- cleanups and frees tree instance
+ */
+int
+art_olc_delete(PMEMobjpool *pop, TOID(struct art_olc) *map)
+{
+	if (art_olc_clear(pop, *map))
+		return 1;
+
+	art_olc_state_drop(map->oid);
+	pmemobj_free(&map->oid);
+
+	return 0;
+}
+
+/*
+ * art_olc_insert -- inserts a new key-value pair into the tree
+ */
+int
+art_olc_insert(PMEMobjpool *pop, TOID(struct art_olc) map,
+	uint64_t key, PMEMoid value)
+{
+	struct art_olc_state *s = art_olc_state_get(pop, map.oid);
+	if (s == NULL)
+		return 1;
+
+	uint8_t buf[sizeof(key)];
+	art_olc_key_encode(key, buf);
+
+	art_olc_enter(s);
+	int ret = art_olc_insert_key(pop, s, buf, sizeof(buf), value.off);
+	art_olc_exit(s);
+
+	return ret;
+}
+
+struct art_olc_value_args {
+	void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg);
+	void *arg;
+};
+
+/*
+ * art_olc_value_create -- (internal) calls the constructor of a new value
+ */
+static int
+art_olc_value_create(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	struct art_olc_value_args *args = arg;
+	args->constructor(pop, ptr, args->arg);
+
+	return 0;
+}
+
+/*
+ * art_olc_insert_new -- allocates a new object and inserts it into the tree,
+ * the object leaks if the insertion is interrupted
+ */
+int
+art_olc_insert_new(PMEMobjpool *pop, TOID(struct art_olc) map,
+		uint64_t key, size_t size, unsigned int type_num,
+		void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg),
+		void *arg)
+{
+	struct art_olc_value_args args = {constructor, arg};
+	PMEMoid n;
+	if (pmemobj_alloc(pop, &n, size, type_num,
+			art_olc_value_create, &args))
+		return 1;
+
+	return art_olc_insert(pop, map, key, n);
+}
+
+/*
+ * art_olc_remove -- removes key-value pair from the tree
+ */
+PMEMoid
+art_olc_remove(PMEMobjpool *pop, TOID(struct art_olc) map, uint64_t key)
+{
+	struct art_olc_state *s = art_olc_state_get(pop, map.oid);
+	if (s == NULL)
+		return OID_NULL;
+
+	uint8_t buf[sizeof(key)];
+	art_olc_key_encode(key, buf);
+
+	PMEMoid value = OID_NULL;
+	art_olc_enter(s);
+	art_olc_remove_key(pop, s, buf, sizeof(buf), &value);
+	art_olc_exit(s);
+
+	return value;
+}
+
+/*
+ * art_olc_remove_free -- removes and frees an object from the tree
+ */
+int
+art_olc_remove_free(PMEMobjpool *pop, TOID(struct art_olc) map,
+		uint64_t key)
+{
+	PMEMoid val = art_olc_remove(pop, map, key);
+	pmemobj_free(&val);
+
+	return 0;
+}
+
+/*
+ * art_olc_get -- searches for a value of the key
+ */
+PMEMoid
+art_olc_get(PMEMobjpool *pop, TOID(struct art_olc) map, uint64_t key)
+{
+	struct art_olc_state *s = art_olc_state_get(pop, map.oid);
+	if (s == NULL)
+		return OID_NULL;
+
+	uint8_t buf[sizeof(key)];
+	art_olc_key_encode(key, buf);
+
+	PMEMoid value = OID_NULL;
+	art_olc_enter(s);
+	art_olc_get_key(pop, s, buf, sizeof(buf), &value);
+	art_olc_exit(s);
+
+	return value;
+}
+
+/*
+ * art_olc_lookup -- searches if a key exists
+ */
+int
+art_olc_lookup(PMEMobjpool *pop, TOID(struct art_olc) map, uint64_t key)
+{
+	struct art_olc_state *s = art_olc_state_get(pop, map.oid);
+	if (s == NULL)
+		return 0;
+
+	uint8_t buf[sizeof(key)];
+	art_olc_key_encode(key, buf);
+
+	PMEMoid value;
+	art_olc_enter(s);
+	int ret = art_olc_get_key(pop, s, buf, sizeof(buf), &value);
+	art_olc_exit(s);
+
+	return ret;
+}
+
+/*
+ * art_olc_range -- visits, in ascending order, all key-value pairs with keys
+ * from the <start, end> range until the callback returns non-zero
+ */
+int
+art_olc_range(PMEMobjpool *pop, TOID(struct art_olc) map,
+	uint64_t start, uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	if (start > end)
+		return 0;
+
+	struct art_olc_state *s = art_olc_state_get(pop, map.oid);
+	if (s == NULL)
+		return 1;
+
+	int ret = 0;
+	art_olc_enter(s);
+
+	uint8_t buf[sizeof(start)];
+	uint64_t key = start;
+	uint64_t ref;
+	for (;;) {
+		art_olc_key_encode(key, buf);
+		if (!art_olc_seek(pop, s, buf, sizeof(buf), &ref))
+			break;
+
+		struct art_olc_leaf *e = LEAF(pop, ref);
+		key = art_olc_key_decode(e->key);
+		if (key > end)
+			break;
+
+		if (cb(key, art_olc_value(s, e), arg)) {
+			ret = 1;
+			break;
+		}
+
+		if (key == UINT64_MAX)
+			break;
+		key++;
+	}
+
+	art_olc_exit(s);
+
+	return ret;
+}
+
+/*
+ * art_olc_foreach -- calls function for each element of the tree
+ */
+int
+art_olc_foreach(PMEMobjpool *pop, TOID(struct art_olc) map,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	return art_olc_range(pop, map, 0, UINT64_MAX, cb, arg);
+}
+
+/*
+ * art_olc_is_empty -- checks whether the tree is empty
+ */
+int
+art_olc_is_empty(PMEMobjpool *pop, TOID(struct art_olc) map)
+{
+	return LOAD(D_RO(map)->root) == 0;
+}
+
+/*
+ * art_olc_count -- returns the number of elements in the tree
+ */
+size_t
+art_olc_count(PMEMobjpool *pop, TOID(struct art_olc) map)
+{
+	struct art_olc_state *s = art_olc_state_get(pop, map.oid);
+	if (s == NULL)
+		return 0;
+
+	return __atomic_load_n(&s->count, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * art_olc_check -- check if given persistent object is a tree
+ */
+int
+art_olc_check(PMEMobjpool *pop, TOID(struct art_olc) map)
+{
+	return TOID_IS_NULL(map) || !TOID_VALID(map);
+}
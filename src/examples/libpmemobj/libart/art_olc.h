@@ -0,0 +1,78 @@
+/*
+ * Copyright 2015-2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * art_olc.h -- concurrent adaptive radix tree with optimistic lock coupling
+ */
+
+#ifndef ART_OLC_H
+#define ART_OLC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <libpmemobj.h>
+
+#ifndef ART_OLC_TYPE_OFFSET
+#define ART_OLC_TYPE_OFFSET 1024
+#endif
+
+struct art_olc;
+TOID_DECLARE(struct art_olc, ART_OLC_TYPE_OFFSET + 0);
+
+int art_olc_check(PMEMobjpool *pop, TOID(struct art_olc) map);
+int art_olc_new(PMEMobjpool *pop, TOID(struct art_olc) *map, void *arg);
+int art_olc_init(PMEMobjpool *pop, TOID(struct art_olc) map);
+int art_olc_delete(PMEMobjpool *pop, TOID(struct art_olc) *map);
+int art_olc_insert(PMEMobjpool *pop, TOID(struct art_olc) map,
+		uint64_t key, PMEMoid value);
+int art_olc_insert_new(PMEMobjpool *pop, TOID(struct art_olc) map,
+		uint64_t key, size_t size, unsigned int type_num,
+		void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg),
+		void *arg);
+PMEMoid art_olc_remove(PMEMobjpool *pop, TOID(struct art_olc) map,
+		uint64_t key);
+int art_olc_remove_free(PMEMobjpool *pop, TOID(struct art_olc) map,
+		uint64_t key);
+int art_olc_clear(PMEMobjpool *pop, TOID(struct art_olc) map);
+PMEMoid art_olc_get(PMEMobjpool *pop, TOID(struct art_olc) map,
+		uint64_t key);
+int art_olc_lookup(PMEMobjpool *pop, TOID(struct art_olc) map,
+		uint64_t key);
+int art_olc_foreach(PMEMobjpool *pop, TOID(struct art_olc) map,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg);
+int art_olc_range(PMEMobjpool *pop, TOID(struct art_olc) map,
+	uint64_t start, uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg);
+int art_olc_is_empty(PMEMobjpool *pop, TOID(struct art_olc) map);
+size_t art_olc_count(PMEMobjpool *pop, TOID(struct art_olc) map);
+
+#endif /* ART_OLC_H */
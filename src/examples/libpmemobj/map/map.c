@@ -205,6 +205,90 @@ map_foreach(struct map_ctx *mapc, TOID(struct map) map,
 	return mapc->ops->foreach(mapc->pop, map, cb, arg);
 }
 
+/*
+ * map_range -- iterate through key value pairs from the <start, end> range
+ * in ascending order of keys
+ */
+int
+map_range(struct map_ctx *mapc, TOID(struct map) map,
+		uint64_t start, uint64_t end,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg)
+{
+	ABORT_NOT_IMPLEMENTED(mapc, range);
+	return mapc->ops->range(mapc->pop, map, start, end, cb, arg);
+}
+
+/*
+ * map_iter_seek -- position the iterator at the beginning of a range
+ */
+void
+map_iter_seek(struct map_iter *iter, uint64_t start, uint64_t end)
+{
+	iter->next = start;
+	iter->end = end;
+	iter->done = start > end;
+}
+
+struct map_iter_arg {
+	int (*cb)(uint64_t key, PMEMoid value, void *arg);
+	void *arg;
+	size_t limit;
+	size_t count;
+	uint64_t last;
+	int stopped;
+};
+
+/*
+ * map_iter_cb -- (internal) counts visited pairs and enforces the limit
+ */
+static int
+map_iter_cb(uint64_t key, PMEMoid value, void *arg)
+{
+	struct map_iter_arg *iarg = arg;
+
+	iarg->count++;
+	iarg->last = key;
+
+	if (iarg->cb && iarg->cb(key, value, iarg->arg) != 0) {
+		iarg->stopped = 1;
+		return 1;
+	}
+
+	return iarg->count == iarg->limit;
+}
+
+/*
+ * map_iter_next -- visit at most limit next key value pairs of the range,
+ * returns the number of visited pairs
+ */
+size_t
+map_iter_next(struct map_ctx *mapc, TOID(struct map) map,
+		struct map_iter *iter, size_t limit,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg)
+{
+	if (iter->done || limit == 0)
+		return 0;
+
+	struct map_iter_arg iarg = {
+		.cb = cb,
+		.arg = arg,
+		.limit = limit,
+	};
+
+	map_range(mapc, map, iter->next, iter->end, map_iter_cb, &iarg);
+
+	if (iarg.count < limit && !iarg.stopped)
+		iter->done = 1;
+	else if (iarg.last >= iter->end)
+		iter->done = 1;
+	else
+		iter->next = iarg.last + 1;
+
+	return iarg.count;
+}
+
 /*
  * map_is_empty -- check if map is empty
  */
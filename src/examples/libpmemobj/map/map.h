@@ -72,6 +72,10 @@ struct map_ops {
 	int (*foreach)(PMEMobjpool *pop, TOID(struct map) map,
 			int (*cb)(uint64_t key, PMEMoid value, void *arg),
 			void *arg);
+	int (*range)(PMEMobjpool *pop, TOID(struct map) map,
+			uint64_t start, uint64_t end,
+			int (*cb)(uint64_t key, PMEMoid value, void *arg),
+			void *arg);
 	int (*is_empty)(PMEMobjpool *pop, TOID(struct map) map);
 	size_t (*count)(PMEMobjpool *pop, TOID(struct map) map);
 	int (*cmd)(PMEMobjpool *pop, TOID(struct map) map,
@@ -83,6 +87,18 @@ struct map_ctx {
 	const struct map_ops *ops;
 };
 
+/*
+ * map_iter -- cursor of an ordered range scan
+ *
+ * The cursor keeps only the lowest key which has not been visited yet,
+ * so it stays valid across calls and modifications of the map.
+ */
+struct map_iter {
+	uint64_t next;	/* lowest key not visited yet */
+	uint64_t end;	/* highest key of the range */
+	int done;	/* the range is exhausted */
+};
+
 struct map_ctx *map_ctx_init(const struct map_ops *ops, PMEMobjpool *pop);
 void map_ctx_free(struct map_ctx *mapc);
 int map_check(struct map_ctx *mapc, TOID(struct map) map);
@@ -104,6 +120,15 @@ int map_lookup(struct map_ctx *mapc, TOID(struct map) map, uint64_t key);
 int map_foreach(struct map_ctx *mapc, TOID(struct map) map,
 		int (*cb)(uint64_t key, PMEMoid value, void *arg),
 		void *arg);
+int map_range(struct map_ctx *mapc, TOID(struct map) map,
+		uint64_t start, uint64_t end,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg);
+void map_iter_seek(struct map_iter *iter, uint64_t start, uint64_t end);
+size_t map_iter_next(struct map_ctx *mapc, TOID(struct map) map,
+		struct map_iter *iter, size_t limit,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg);
 int map_is_empty(struct map_ctx *mapc, TOID(struct map) map);
 size_t map_count(struct map_ctx *mapc, TOID(struct map) map);
 int map_cmd(struct map_ctx *mapc, TOID(struct map) map,
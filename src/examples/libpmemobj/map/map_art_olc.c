@@ -0,0 +1,248 @@
+/*
+ * Copyright 2015-2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * map_art_olc.c -- common interface for maps
+ */
+
+#include <map.h>
+#include <art_olc.h>
+
+/*
+ * map_art_olc_check -- wrapper for art_olc_check
+ */
+static int
+map_art_olc_check(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_check(pop, art_olc);
+}
+
+/*
+ * map_art_olc_new -- wrapper for art_olc_new
+ */
+static int
+map_art_olc_new(PMEMobjpool *pop, TOID(struct map) *map, void *arg)
+{
+	TOID(struct art_olc) *art_olc =
+		(TOID(struct art_olc) *)map;
+
+	return art_olc_new(pop, art_olc, arg);
+}
+
+/*
+ * map_art_olc_init -- wrapper for art_olc_init
+ */
+static int
+map_art_olc_init(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_init(pop, art_olc);
+}
+
+/*
+ * map_art_olc_delete -- wrapper for art_olc_delete
+ */
+static int
+map_art_olc_delete(PMEMobjpool *pop, TOID(struct map) *map)
+{
+	TOID(struct art_olc) *art_olc =
+		(TOID(struct art_olc) *)map;
+
+	return art_olc_delete(pop, art_olc);
+}
+
+/*
+ * map_art_olc_insert -- wrapper for art_olc_insert
+ */
+static int
+map_art_olc_insert(PMEMobjpool *pop, TOID(struct map) map,
+		uint64_t key, PMEMoid value)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_insert(pop, art_olc, key, value);
+}
+
+/*
+ * map_art_olc_insert_new -- wrapper for art_olc_insert_new
+ */
+static int
+map_art_olc_insert_new(PMEMobjpool *pop, TOID(struct map) map,
+		uint64_t key, size_t size,
+		unsigned int type_num,
+		void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg),
+		void *arg)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_insert_new(pop, art_olc, key, size,
+			type_num, constructor, arg);
+}
+
+/*
+ * map_art_olc_remove -- wrapper for art_olc_remove
+ */
+static PMEMoid
+map_art_olc_remove(PMEMobjpool *pop, TOID(struct map) map, uint64_t key)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_remove(pop, art_olc, key);
+}
+
+/*
+ * map_art_olc_remove_free -- wrapper for art_olc_remove_free
+ */
+static int
+map_art_olc_remove_free(PMEMobjpool *pop, TOID(struct map) map, uint64_t key)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_remove_free(pop, art_olc, key);
+}
+
+/*
+ * map_art_olc_clear -- wrapper for art_olc_clear
+ */
+static int
+map_art_olc_clear(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_clear(pop, art_olc);
+}
+
+/*
+ * map_art_olc_get -- wrapper for art_olc_get
+ */
+static PMEMoid
+map_art_olc_get(PMEMobjpool *pop, TOID(struct map) map, uint64_t key)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_get(pop, art_olc, key);
+}
+
+/*
+ * map_art_olc_lookup -- wrapper for art_olc_lookup
+ */
+static int
+map_art_olc_lookup(PMEMobjpool *pop, TOID(struct map) map, uint64_t key)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_lookup(pop, art_olc, key);
+}
+
+/*
+ * map_art_olc_foreach -- wrapper for art_olc_foreach
+ */
+static int
+map_art_olc_foreach(PMEMobjpool *pop, TOID(struct map) map,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_foreach(pop, art_olc, cb, arg);
+}
+
+/*
+ * map_art_olc_range -- wrapper for art_olc_range
+ */
+static int
+map_art_olc_range(PMEMobjpool *pop, TOID(struct map) map,
+		uint64_t start, uint64_t end,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_range(pop, art_olc, start, end, cb, arg);
+}
+
+/*
+ * map_art_olc_is_empty -- wrapper for art_olc_is_empty
+ */
+static int
+map_art_olc_is_empty(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_is_empty(pop, art_olc);
+}
+
+/*
+ * map_art_olc_count -- wrapper for art_olc_count
+ */
+static size_t
+map_art_olc_count(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_olc) art_olc;
+	TOID_ASSIGN(art_olc, map.oid);
+
+	return art_olc_count(pop, art_olc);
+}
+
+struct map_ops art_olc_map_ops = {
+	.check		= map_art_olc_check,
+	.new		= map_art_olc_new,
+	.delete		= map_art_olc_delete,
+	.init		= map_art_olc_init,
+	.insert		= map_art_olc_insert,
+	.insert_new	= map_art_olc_insert_new,
+	.remove		= map_art_olc_remove,
+	.remove_free	= map_art_olc_remove_free,
+	.clear		= map_art_olc_clear,
+	.get		= map_art_olc_get,
+	.lookup		= map_art_olc_lookup,
+	.is_empty	= map_art_olc_is_empty,
+	.foreach	= map_art_olc_foreach,
+	.range		= map_art_olc_range,
+	.count		= map_art_olc_count,
+	.cmd		= NULL,
+};
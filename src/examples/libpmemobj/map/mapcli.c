@@ -44,6 +44,8 @@
 #include "map_ctree.h"
 #include "map_btree.h"
 #include "map_rbtree.h"
+#include "map_skiplist.h"
+#include "map_art_olc.h"
 #include "map_hashmap_atomic.h"
 #include "map_hashmap_tx.h"
 #include "hashmap/hashmap.h"
@@ -170,6 +172,7 @@ help(void)
 	printf("c $value - check $value, returns 0/1\n");
 	printf("n $value - insert $value random values\n");
 	printf("p - print all values\n");
+	printf("s $start $end [$limit] - print values from the range\n");
 	printf("d - print debug info\n");
 	printf("b [$value] - rebuild $value (default: 1) times\n");
 	printf("q - quit\n");
@@ -196,13 +199,43 @@ print_all(void)
 	printf("\n");
 }
 
+#define SCAN_BATCH 16
+
+/*
+ * str_scan -- prints keys from the given range, at most $limit of them
+ */
+static void
+str_scan(const char *str)
+{
+	uint64_t start;
+	uint64_t end;
+	uint64_t limit = UINT64_MAX;
+	if (sscanf(str, "%lu %lu %lu", &start, &end, &limit) < 2) {
+		fprintf(stderr, "scan: invalid syntax\n");
+		return;
+	}
+
+	struct map_iter iter;
+	map_iter_seek(&iter, start, end);
+
+	/* the iterator is resumed after every batch */
+	while (limit && !iter.done) {
+		size_t n = limit < SCAN_BATCH ? limit : SCAN_BATCH;
+		limit -= map_iter_next(mapc, map, &iter, n,
+				hashmap_print, NULL);
+	}
+	printf("\n");
+}
+
 #define INPUT_BUF_LEN 1000
 int
 main(int argc, char *argv[])
 {
 	if (argc < 3 || argc > 4) {
 		printf("usage: %s hashmap_tx|hashmap_atomic|ctree|btree|rbtree"
-				" file-name [<seed>]\n", argv[0]);
+				"|skiplist|skiplist_mt|art_olc"
+				" file-name [<seed>]\n",
+				argv[0]);
 		return 1;
 	}
 
@@ -219,6 +252,12 @@ main(int argc, char *argv[])
 		ops = MAP_BTREE;
 	} else if (strcmp(type, "rbtree") == 0) {
 		ops = MAP_RBTREE;
+	} else if (strcmp(type, "skiplist") == 0) {
+		ops = MAP_SKIPLIST;
+	} else if (strcmp(type, "skiplist_mt") == 0) {
+		ops = MAP_SKIPLIST_MT;
+	} else if (strcmp(type, "art_olc") == 0) {
+		ops = MAP_ART_OLC;
 	} else {
 		fprintf(stderr, "invalid hasmap type -- '%s'\n", type);
 		return 1;
@@ -298,6 +337,9 @@ main(int argc, char *argv[])
 			case 'p':
 				print_all();
 				break;
+			case 's':
+				str_scan(buf + 1);
+				break;
 			case 'd':
 				map_cmd(mapc, map, HASHMAP_CMD_DEBUG,
 						(uint64_t)stdout);
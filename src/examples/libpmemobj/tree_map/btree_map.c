@@ -621,6 +621,78 @@ btree_map_foreach(PMEMobjpool *pop, TOID(struct btree_map) map,
 	return btree_map_foreach_node(D_RO(map)->root, cb, arg);
 }
 
+/*
+ * btree_map_prefetch_node -- (internal) prefetches all cachelines of a node
+ */
+static void
+btree_map_prefetch_node(TOID(struct tree_map_node) node)
+{
+	if (TOID_IS_NULL(node))
+		return;
+
+	const char *p = (const char *)D_RO(node);
+	for (size_t off = 0; off < sizeof(struct tree_map_node); off += 64)
+		__builtin_prefetch(p + off);
+}
+
+/*
+ * btree_map_range_node -- (internal) traverses the part of the subtree that
+ * contains keys from the <start, end> range
+ */
+static int
+btree_map_range_node(TOID(struct tree_map_node) p,
+	uint64_t start, uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	for (int i = 0; i <= D_RO(p)->n; ++i) {
+		TOID(struct tree_map_node) child = D_RO(p)->slots[i];
+
+		/* the child holds only keys smaller than the item at i */
+		if (!TOID_IS_NULL(child) &&
+			(i == D_RO(p)->n || D_RO(p)->items[i].key > start)) {
+			/*
+			 * The right sibling is visited next, fetch it while
+			 * the current one is being scanned.
+			 */
+			if (i != D_RO(p)->n)
+				btree_map_prefetch_node(D_RO(p)->slots[i + 1]);
+
+			if (btree_map_range_node(child, start, end,
+					cb, arg) != 0)
+				return 1;
+		}
+
+		if (i == D_RO(p)->n)
+			break;
+
+		uint64_t key = D_RO(p)->items[i].key;
+		if (key > end)
+			return 1;
+
+		if (key >= start && key != 0) {
+			if (cb(key, D_RO(p)->items[i].value, arg) != 0)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * btree_map_range -- visits, in ascending order, all key-value pairs with
+ * keys from the <start, end> range until the callback returns non-zero
+ */
+int
+btree_map_range(PMEMobjpool *pop, TOID(struct btree_map) map,
+	uint64_t start, uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	if (TOID_IS_NULL(D_RO(map)->root) || start > end)
+		return 0;
+
+	return btree_map_range_node(D_RO(map)->root, start, end, cb, arg);
+}
+
 /*
  * ctree_map_check -- check if given persistent object is a tree map
  */
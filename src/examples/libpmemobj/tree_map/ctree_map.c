@@ -378,6 +378,104 @@ ctree_map_foreach(PMEMobjpool *pop, TOID(struct ctree_map) map,
 	return ctree_map_foreach_node(D_RO(map)->root, cb, arg);
 }
 
+/*
+ * ctree_map_range_all -- (internal) visits all leafs of the subtree in
+ * ascending order, stops at the first key past the end of the range
+ */
+static int
+ctree_map_range_all(struct tree_map_entry e, uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	if (!OID_IS_NULL(e.slot) &&
+			OID_INSTANCEOF(e.slot, struct tree_map_node)) {
+		TOID(struct tree_map_node) node;
+		TOID_ASSIGN(node, e.slot);
+
+		if (ctree_map_range_all(D_RO(node)->entries[0],
+				end, cb, arg) != 0)
+			return 1;
+
+		return ctree_map_range_all(D_RO(node)->entries[1],
+				end, cb, arg);
+	}
+
+	if (e.key > end)
+		return 1;
+
+	return cb(e.key, e.slot, arg);
+}
+
+/*
+ * ctree_map_range_from -- (internal) follows the path of the start key and
+ * visits only the subtrees which contain keys not less than the start key
+ *
+ * All keys in a subtree share the bits above its critical bit and, on the
+ * path of the start key, the bits above crit are shared with the start key
+ * as well. Once the path reaches a subtree with a lower critical bit, all of
+ * its keys are either smaller or greater than the start key, depending on
+ * the value of the start key bit at crit.
+ */
+static int
+ctree_map_range_from(struct tree_map_entry e, uint64_t start, int crit,
+	uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	if (!OID_IS_NULL(e.slot) &&
+			OID_INSTANCEOF(e.slot, struct tree_map_node)) {
+		TOID(struct tree_map_node) node;
+		TOID_ASSIGN(node, e.slot);
+
+		int diff = D_RO(node)->diff;
+		if (diff > crit) {
+			/* the other subtree is entirely on one side of start */
+			if (BIT_IS_SET(start, diff))
+				return ctree_map_range_from(
+					D_RO(node)->entries[1],
+					start, crit, end, cb, arg);
+
+			if (ctree_map_range_from(D_RO(node)->entries[0],
+					start, crit, end, cb, arg) != 0)
+				return 1;
+
+			return ctree_map_range_all(D_RO(node)->entries[1],
+					end, cb, arg);
+		}
+	}
+
+	if (crit >= 0 && BIT_IS_SET(start, crit))
+		return 0; /* the whole subtree is smaller than start */
+
+	return ctree_map_range_all(e, end, cb, arg);
+}
+
+/*
+ * ctree_map_range -- visits, in ascending order, all key-value pairs with
+ * keys from the <start, end> range until the callback returns non-zero
+ */
+int
+ctree_map_range(PMEMobjpool *pop, TOID(struct ctree_map) map,
+	uint64_t start, uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	if ((D_RO(map)->root.key == 0 && OID_IS_NULL(D_RO(map)->root.slot))
+			|| start > end)
+		return 0;
+
+	/* find the best matching leaf and the bit where it differs */
+	const struct tree_map_entry *p = &D_RO(map)->root;
+	TOID(struct tree_map_node) node;
+	while (!OID_IS_NULL(p->slot) &&
+			OID_INSTANCEOF(p->slot, struct tree_map_node)) {
+		TOID_ASSIGN(node, p->slot);
+		p = &D_RO(node)->entries[BIT_IS_SET(start, D_RO(node)->diff)];
+	}
+
+	int crit = p->key == start ? -1 : find_crit_bit(p->key, start);
+
+	return ctree_map_range_from(D_RO(map)->root, start, crit,
+			end, cb, arg);
+}
+
 /*
  * ctree_map_is_empty -- checks whether the tree map is empty
  */
@@ -495,6 +495,51 @@ rbtree_map_foreach(PMEMobjpool *pop, TOID(struct rbtree_map) map,
 	return rbtree_map_foreach_node(map, RB_FIRST(map), cb, arg);
 }
 
+/*
+ * rbtree_map_find_lower_bound -- (internal) returns the node with the smallest
+ * key that is not less than the given one
+ */
+static TOID(struct tree_map_node)
+rbtree_map_find_lower_bound(TOID(struct rbtree_map) map, uint64_t key)
+{
+	TOID(struct tree_map_node) dst = RB_FIRST(map);
+	TOID(struct tree_map_node) s = D_RO(map)->sentinel;
+	TOID(struct tree_map_node) lb = s;
+
+	while (!NODE_IS_NULL(dst)) {
+		if (D_RO(dst)->key == key)
+			return dst;
+
+		if (D_RO(dst)->key > key)
+			lb = dst;
+
+		dst = D_RO(dst)->slots[key > D_RO(dst)->key];
+	}
+
+	return lb;
+}
+
+/*
+ * rbtree_map_range -- visits, in ascending order, all key-value pairs with
+ * keys from the <start, end> range until the callback returns non-zero
+ */
+int
+rbtree_map_range(PMEMobjpool *pop, TOID(struct rbtree_map) map,
+	uint64_t start, uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	TOID(struct tree_map_node) s = D_RO(map)->sentinel;
+	TOID(struct tree_map_node) n = rbtree_map_find_lower_bound(map, start);
+
+	for (; !NODE_IS_NULL(n) && D_RO(n)->key <= end;
+			n = rbtree_map_successor(map, n)) {
+		if (cb(D_RO(n)->key, D_RO(n)->value, arg) != 0)
+			return 1;
+	}
+
+	return 0;
+}
+
 /*
  * rbtree_map_is_empty -- checks whether the tree map is empty
  */
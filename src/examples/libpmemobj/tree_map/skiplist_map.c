@@ -0,0 +1,1153 @@
+/*
+ * Copyright 2015-2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * skiplist_map.c -- skip list with a persistent bottom level
+ *
+ * Only the bottom level of the skip list -- the sorted list of entries --
+ * is stored in the pool. Its links are 8-byte pool offsets, so an entry is
+ * published with a single compare-and-swap followed by a persist and no
+ * transaction is needed to insert or remove a key. Two low bits of a link
+ * are used as flags:
+ *  - SKIPLIST_REMOVED marks the link of a removed entry; setting it is the
+ *    durable point of the removal, unlinking and freeing the entry follow
+ *    and are finished by the recovery if interrupted,
+ *  - SKIPLIST_DIRTY marks a link which may not be persistent yet; whoever
+ *    reads such a link persists it before relying on it.
+ *
+ * The upper levels (towers) are kept in DRAM only and are rebuilt from the
+ * bottom level on the first access after the pool is opened. All levels
+ * are lock-free. In the concurrent mode the memory of removed entries and
+ * towers is reclaimed once no other operation on the map is in progress.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "skiplist_map.h"
+
+#define SKIPLIST_LEVELS 16 /* number of DRAM levels */
+
+#define SKIPLIST_REMOVED 1ULL
+#define SKIPLIST_DIRTY 2ULL
+#define SKIPLIST_FLAGS (SKIPLIST_REMOVED | SKIPLIST_DIRTY)
+
+#define LINK_OFF(v) ((v) & ~SKIPLIST_FLAGS)
+#define LINK_REMOVED(v) ((v) & SKIPLIST_REMOVED)
+
+#define ENTRY(pop, off)\
+((struct skiplist_map_entry *)((uintptr_t)(pop) + (off)))
+
+#define TOWER(v) ((struct skiplist_tower *)LINK_OFF(v))
+
+TOID_DECLARE(struct skiplist_map_entry, SKIPLIST_MAP_TYPE_OFFSET + 1);
+
+struct skiplist_map_entry {
+	uint64_t key;
+	uint64_t value;	/* offset of the value, 0 for OID_NULL */
+	uint64_t next;	/* offset of the next entry and the link flags */
+	uint64_t map;	/* offset of the owning map */
+};
+
+struct skiplist_map {
+	uint64_t flags;
+	struct skiplist_map_entry head; /* sentinel of the bottom level */
+};
+
+/* DRAM tower of an entry */
+struct skiplist_tower {
+	uint64_t key;
+	uint64_t entry;		/* offset of the persistent entry */
+	int height;		/* number of levels */
+	int inserted;		/* all levels which could be linked are */
+	int retired;		/* the tower is being unlinked for good */
+	uintptr_t next[];	/* links, marked when the entry is removed */
+};
+
+/* memory waiting for the concurrent operations to finish */
+struct skiplist_retired {
+	struct skiplist_retired *next;
+	struct skiplist_tower *tower;
+	uint64_t entry;
+};
+
+/* volatile state of a map */
+struct skiplist_state {
+	struct skiplist_state *next;
+	uint64_t pool_uuid_lo;
+	uint64_t off;
+	uint64_t flags;
+
+	uint64_t count;		/* number of entries */
+	uint64_t active;	/* number of operations in progress */
+	struct skiplist_retired *retired;
+	struct skiplist_tower *head;
+};
+
+static struct skiplist_state *skiplist_states;
+static pthread_mutex_t skiplist_states_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread uint64_t skiplist_rnd;
+
+/*
+ * skiplist_random_height -- (internal) draws the number of DRAM levels of
+ * an entry, every level is four times less likely than the one below
+ */
+static int
+skiplist_random_height(void)
+{
+	if (skiplist_rnd == 0)
+		skiplist_rnd = ((uint64_t)time(NULL) ^
+				(uintptr_t)&skiplist_rnd) | 1;
+
+	/* xorshift64 */
+	skiplist_rnd ^= skiplist_rnd << 13;
+	skiplist_rnd ^= skiplist_rnd >> 7;
+	skiplist_rnd ^= skiplist_rnd << 17;
+
+	uint64_t r = skiplist_rnd;
+	int height = 0;
+	while ((r & 3) == 0 && height < SKIPLIST_LEVELS) {
+		height++;
+		r >>= 2;
+	}
+
+	return height;
+}
+
+/*
+ * skiplist_load -- (internal) reads a persistent link, persists it first
+ * if its writer has not done it yet
+ */
+static uint64_t
+skiplist_load(PMEMobjpool *pop, uint64_t *link)
+{
+	uint64_t v = __atomic_load_n(link, __ATOMIC_ACQUIRE);
+	if (v & SKIPLIST_DIRTY) {
+		pmemobj_persist(pop, link, sizeof(*link));
+		__sync_bool_compare_and_swap(link, v, v & ~SKIPLIST_DIRTY);
+		v &= ~SKIPLIST_DIRTY;
+	}
+
+	return v;
+}
+
+/*
+ * skiplist_cas -- (internal) atomically replaces and persists a persistent
+ * link
+ */
+static int
+skiplist_cas(PMEMobjpool *pop, uint64_t *link, uint64_t old, uint64_t new)
+{
+	if (!__sync_bool_compare_and_swap(link, old, new | SKIPLIST_DIRTY))
+		return 0;
+
+	pmemobj_persist(pop, link, sizeof(*link));
+	__sync_bool_compare_and_swap(link, new | SKIPLIST_DIRTY, new);
+
+	return 1;
+}
+
+/*
+ * skiplist_value -- (internal) returns the value of the entry
+ */
+static PMEMoid
+skiplist_value(PMEMobjpool *pop, struct skiplist_state *s,
+	struct skiplist_map_entry *e)
+{
+	PMEMoid value = OID_NULL;
+	uint64_t off = skiplist_load(pop, &e->value);
+	if (off != 0) {
+		value.pool_uuid_lo = s->pool_uuid_lo;
+		value.off = off;
+	}
+
+	return value;
+}
+
+/*
+ * skiplist_tower_new -- (internal) allocates a tower of the given height
+ */
+static struct skiplist_tower *
+skiplist_tower_new(uint64_t key, uint64_t entry, int height)
+{
+	struct skiplist_tower *t =
+		calloc(1, sizeof(*t) + height * sizeof(t->next[0]));
+	if (t == NULL)
+		return NULL;
+
+	t->key = key;
+	t->entry = entry;
+	t->height = height;
+
+	return t;
+}
+
+/*
+ * skiplist_free -- (internal) frees an unlinked tower and/or entry
+ */
+static void
+skiplist_free(struct skiplist_state *s, struct skiplist_tower *t,
+	uint64_t entry)
+{
+	free(t);
+	if (entry != 0) {
+		PMEMoid oid = {s->pool_uuid_lo, entry};
+		pmemobj_free(&oid);
+	}
+}
+
+/*
+ * skiplist_reclaim -- (internal) frees the retired memory
+ */
+static void
+skiplist_reclaim(struct skiplist_state *s, struct skiplist_retired *r)
+{
+	while (r != NULL) {
+		struct skiplist_retired *next = r->next;
+		skiplist_free(s, r->tower, r->entry);
+		free(r);
+		r = next;
+	}
+}
+
+/*
+ * skiplist_push -- (internal) adds a list of retired memory to the map
+ */
+static void
+skiplist_push(struct skiplist_state *s, struct skiplist_retired *first,
+	struct skiplist_retired *last)
+{
+	do {
+		last->next = __atomic_load_n(&s->retired, __ATOMIC_ACQUIRE);
+	} while (!__sync_bool_compare_and_swap(&s->retired, last->next, first));
+}
+
+/*
+ * skiplist_retire -- (internal) frees an unlinked tower and/or entry as soon
+ * as no other operation can hold a reference to them
+ */
+static void
+skiplist_retire(struct skiplist_state *s, struct skiplist_tower *t,
+	uint64_t entry)
+{
+	if (!(s->flags & SKIPLIST_MAP_CONCURRENT)) {
+		skiplist_free(s, t, entry);
+		return;
+	}
+
+	/* on failure the entry is freed by the recovery */
+	struct skiplist_retired *r = malloc(sizeof(*r));
+	if (r == NULL)
+		return;
+
+	r->tower = t;
+	r->entry = entry;
+	skiplist_push(s, r, r);
+}
+
+/*
+ * skiplist_enter -- (internal) registers an operation in progress
+ */
+static void
+skiplist_enter(struct skiplist_state *s)
+{
+	if (s->flags & SKIPLIST_MAP_CONCURRENT)
+		__sync_fetch_and_add(&s->active, 1);
+}
+
+/*
+ * skiplist_exit -- (internal) finishes an operation, reclaims the retired
+ * memory if it is the only one in progress
+ */
+static void
+skiplist_exit(struct skiplist_state *s)
+{
+	if (!(s->flags & SKIPLIST_MAP_CONCURRENT))
+		return;
+
+	struct skiplist_retired *r = NULL;
+	if (__atomic_load_n(&s->retired, __ATOMIC_ACQUIRE) != NULL)
+		r = __atomic_exchange_n(&s->retired, NULL, __ATOMIC_SEQ_CST);
+
+	if (r != NULL) {
+		/*
+		 * Everything on the list was unlinked before, so only the
+		 * operations which are still in progress could have seen it.
+		 */
+		if (__atomic_load_n(&s->active, __ATOMIC_SEQ_CST) == 1) {
+			skiplist_reclaim(s, r);
+		} else {
+			struct skiplist_retired *last = r;
+			while (last->next != NULL)
+				last = last->next;
+			skiplist_push(s, r, last);
+		}
+	}
+
+	__sync_fetch_and_sub(&s->active, 1);
+}
+
+/*
+ * skiplist_tower_find -- (internal) finds on every DRAM level the last tower
+ * with a key lower than (or not greater than, if past is set) the given one
+ * and unlinks removed towers on the way, returns the offset of the entry
+ * from which the bottom level search may start
+ */
+static uint64_t
+skiplist_tower_find(struct skiplist_state *s, uint64_t key, int past,
+	struct skiplist_tower **preds, struct skiplist_tower **succs)
+{
+	struct skiplist_tower *pred;
+	struct skiplist_tower *curr;
+retry:
+	pred = s->head;
+	for (int l = SKIPLIST_LEVELS - 1; l >= 0; --l) {
+		curr = TOWER(__atomic_load_n(&pred->next[l], __ATOMIC_ACQUIRE));
+		while (curr != NULL) {
+			uintptr_t next = __atomic_load_n(&curr->next[l],
+					__ATOMIC_ACQUIRE);
+			if (LINK_REMOVED(next)) {
+				if (!__sync_bool_compare_and_swap(
+						&pred->next[l],
+						(uintptr_t)curr,
+						LINK_OFF(next)))
+					goto retry;
+				curr = TOWER(next);
+				continue;
+			}
+
+			if (curr->key > key || (curr->key == key && !past))
+				break;
+
+			pred = curr;
+			curr = TOWER(next);
+		}
+
+		if (preds != NULL) {
+			preds[l] = pred;
+			succs[l] = curr;
+		}
+	}
+
+	return pred->entry;
+}
+
+/*
+ * skiplist_tower_remove -- (internal) marks all levels of the tower and,
+ * once its inserter is done, unlinks and retires it
+ */
+static void
+skiplist_tower_remove(struct skiplist_state *s, struct skiplist_tower *t)
+{
+	for (int l = t->height - 1; l >= 0; --l) {
+		uintptr_t next;
+		do {
+			next = __atomic_load_n(&t->next[l], __ATOMIC_ACQUIRE);
+		} while (!LINK_REMOVED(next) &&
+			!__sync_bool_compare_and_swap(&t->next[l], next,
+				next | SKIPLIST_REMOVED));
+	}
+
+	/* the inserter calls this once more when it is done */
+	if (!__atomic_load_n(&t->inserted, __ATOMIC_SEQ_CST))
+		return;
+
+	if (!__sync_bool_compare_and_swap(&t->retired, 0, 1))
+		return;
+
+	skiplist_tower_find(s, t->key, 1, NULL, NULL);
+	skiplist_retire(s, t, 0);
+}
+
+/*
+ * skiplist_tower_insert -- (internal) links the tower of a new entry, level
+ * by level starting from the lowest one
+ */
+static void
+skiplist_tower_insert(PMEMobjpool *pop, struct skiplist_state *s,
+	struct skiplist_tower *t,
+	struct skiplist_tower **preds, struct skiplist_tower **succs)
+{
+	struct skiplist_map_entry *e = ENTRY(pop, t->entry);
+
+	for (int l = 0; l < t->height; ++l) {
+		for (;;) {
+			if (LINK_REMOVED(__atomic_load_n(&e->next,
+					__ATOMIC_ACQUIRE)))
+				goto out;
+
+			uintptr_t next = __atomic_load_n(&t->next[l],
+					__ATOMIC_ACQUIRE);
+			if (LINK_REMOVED(next))
+				goto out;
+
+			if (next != (uintptr_t)succs[l] &&
+				!__sync_bool_compare_and_swap(&t->next[l],
+					next, (uintptr_t)succs[l]))
+				goto out;
+
+			if (__sync_bool_compare_and_swap(&preds[l]->next[l],
+					(uintptr_t)succs[l], (uintptr_t)t))
+				break;
+
+			skiplist_tower_find(s, t->key, 0, preds, succs);
+		}
+	}
+out:
+	__atomic_store_n(&t->inserted, 1, __ATOMIC_SEQ_CST);
+
+	/* the entry may have been removed before the tower was complete */
+	if (LINK_REMOVED(__atomic_load_n(&e->next, __ATOMIC_SEQ_CST)))
+		skiplist_tower_remove(s, t);
+}
+
+/*
+ * skiplist_tower_lookup -- (internal) looks for the tower of the entry
+ */
+static struct skiplist_tower *
+skiplist_tower_lookup(struct skiplist_state *s, uint64_t key, uint64_t entry)
+{
+	struct skiplist_tower *preds[SKIPLIST_LEVELS];
+	struct skiplist_tower *succs[SKIPLIST_LEVELS];
+
+	skiplist_tower_find(s, key, 0, preds, succs);
+
+	for (int l = SKIPLIST_LEVELS - 1; l >= 0; --l) {
+		struct skiplist_tower *t = succs[l];
+		while (t != NULL && t->key == key) {
+			if (t->entry == entry)
+				return t;
+			t = TOWER(__atomic_load_n(&t->next[l],
+					__ATOMIC_ACQUIRE));
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * skiplist_entry_find -- (internal) finds on the bottom level the first
+ * entry with a key not lower than the given one and its predecessor,
+ * unlinks removed entries on the way
+ */
+static uint64_t
+skiplist_entry_find(PMEMobjpool *pop, struct skiplist_state *s,
+	uint64_t start, uint64_t key, uint64_t *predp)
+{
+	uint64_t pred;
+	uint64_t curr;
+retry:
+	pred = start;
+	curr = skiplist_load(pop, &ENTRY(pop, pred)->next);
+	if (LINK_REMOVED(curr)) {
+		/* the entry to start from has been removed in the meantime */
+		start = s->head->entry;
+		goto retry;
+	}
+
+	while (curr != 0) {
+		struct skiplist_map_entry *e = ENTRY(pop, curr);
+		uint64_t next = skiplist_load(pop, &e->next);
+		if (LINK_REMOVED(next)) {
+			if (!skiplist_cas(pop, &ENTRY(pop, pred)->next,
+					curr, LINK_OFF(next)))
+				goto retry;
+			curr = LINK_OFF(next);
+			continue;
+		}
+
+		if (e->key >= key)
+			break;
+
+		pred = curr;
+		curr = next;
+	}
+
+	*predp = pred;
+	return curr;
+}
+
+/*
+ * skiplist_entry_seek -- (internal) returns the first entry, which has not
+ * been removed, with a key not lower than the given one; does not write
+ */
+static uint64_t
+skiplist_entry_seek(PMEMobjpool *pop, struct skiplist_state *s,
+	uint64_t start, uint64_t key)
+{
+	uint64_t curr = skiplist_load(pop, &ENTRY(pop, start)->next);
+	if (LINK_REMOVED(curr))
+		curr = skiplist_load(pop, &ENTRY(pop, s->head->entry)->next);
+
+	curr = LINK_OFF(curr);
+	while (curr != 0) {
+		struct skiplist_map_entry *e = ENTRY(pop, curr);
+		uint64_t next = skiplist_load(pop, &e->next);
+		if (!LINK_REMOVED(next) && e->key >= key)
+			break;
+
+		curr = LINK_OFF(next);
+	}
+
+	return curr;
+}
+
+/*
+ * skiplist_state_free -- (internal) frees the volatile state of the map
+ */
+static void
+skiplist_state_free(struct skiplist_state *s)
+{
+	skiplist_reclaim(s, s->retired);
+
+	struct skiplist_tower *t = s->head;
+	while (t != NULL) {
+		struct skiplist_tower *next = TOWER(t->next[0]);
+		free(t);
+		t = next;
+	}
+
+	free(s);
+}
+
+/*
+ * skiplist_offset_cmp -- (internal) compares two pool offsets
+ */
+static int
+skiplist_offset_cmp(const void *lhs, const void *rhs)
+{
+	uint64_t l = *(const uint64_t *)lhs;
+	uint64_t r = *(const uint64_t *)rhs;
+
+	return l < r ? -1 : l > r;
+}
+
+/*
+ * skiplist_state_new -- (internal) rebuilds the DRAM levels of the map,
+ * finishes interrupted removals and frees the entries which were allocated
+ * but never linked or unlinked but not freed
+ */
+static struct skiplist_state *
+skiplist_state_new(PMEMobjpool *pop, PMEMoid map)
+{
+	struct skiplist_map *m = pmemobj_direct(map);
+	struct skiplist_state *s = calloc(1, sizeof(*s));
+	if (s == NULL)
+		return NULL;
+
+	s->pool_uuid_lo = map.pool_uuid_lo;
+	s->off = map.off;
+	s->flags = m->flags;
+	s->head = skiplist_tower_new(0,
+		map.off + offsetof(struct skiplist_map, head),
+		SKIPLIST_LEVELS);
+	if (s->head == NULL)
+		goto err_free_state;
+
+	struct skiplist_tower *last[SKIPLIST_LEVELS];
+	for (int l = 0; l < SKIPLIST_LEVELS; ++l)
+		last[l] = s->head;
+
+	uint64_t *live = NULL;
+	size_t nlive = 0;
+	size_t size = 0;
+
+	struct skiplist_map_entry *pred = &m->head;
+	for (;;) {
+		if (pred->next & SKIPLIST_DIRTY) {
+			PM_EQU(pred->next, pred->next & ~SKIPLIST_DIRTY);
+			pmemobj_persist(pop, &pred->next, sizeof(pred->next));
+		}
+
+		uint64_t curr = pred->next;
+		if (curr == 0)
+			break;
+
+		struct skiplist_map_entry *e = ENTRY(pop, curr);
+		if (LINK_REMOVED(e->next)) {
+			/* finish the interrupted removal */
+			PM_EQU(pred->next, LINK_OFF(e->next));
+			pmemobj_persist(pop, &pred->next, sizeof(pred->next));
+			continue;
+		}
+
+		if (e->value & SKIPLIST_DIRTY) {
+			PM_EQU(e->value, e->value & ~SKIPLIST_DIRTY);
+			pmemobj_persist(pop, &e->value, sizeof(e->value));
+		}
+
+		if (nlive == size) {
+			size = size ? size * 2 : 64;
+			uint64_t *tmp = realloc(live, size * sizeof(*live));
+			if (tmp == NULL)
+				goto err_free_live;
+			live = tmp;
+		}
+		live[nlive++] = curr;
+
+		int height = skiplist_random_height();
+		if (height != 0) {
+			struct skiplist_tower *t =
+				skiplist_tower_new(e->key, curr, height);
+			if (t == NULL)
+				goto err_free_live;
+
+			t->inserted = 1;
+			for (int l = 0; l < height; ++l) {
+				last[l]->next[l] = (uintptr_t)t;
+				last[l] = t;
+			}
+		}
+
+		pred = e;
+	}
+
+	s->count = nlive;
+
+	/* free the entries of the map which are not reachable */
+	qsort(live, nlive, sizeof(*live), skiplist_offset_cmp);
+
+	PMEMoid oid = POBJ_FIRST_TYPE_NUM(pop,
+			TOID_TYPE_NUM(struct skiplist_map_entry));
+	while (!OID_IS_NULL(oid)) {
+		PMEMoid next = POBJ_NEXT_TYPE_NUM(oid);
+		struct skiplist_map_entry *e = pmemobj_direct(oid);
+		if (e->map == map.off && bsearch(&oid.off, live, nlive,
+				sizeof(*live), skiplist_offset_cmp) == NULL)
+			pmemobj_free(&oid);
+		oid = next;
+	}
+
+	free(live);
+	return s;
+
+err_free_live:
+	free(live);
+	skiplist_state_free(s);
+	return NULL;
+err_free_state:
+	free(s);
+	return NULL;
+}
+
+/*
+ * skiplist_state_find -- (internal) looks up the volatile state of the map
+ */
+static struct skiplist_state *
+skiplist_state_find(PMEMoid map)
+{
+	struct skiplist_state *s =
+		__atomic_load_n(&skiplist_states, __ATOMIC_ACQUIRE);
+
+	for (; s != NULL; s = s->next)
+		if (s->pool_uuid_lo == map.pool_uuid_lo && s->off == map.off)
+			return s;
+
+	return NULL;
+}
+
+/*
+ * skiplist_state_drop -- (internal) frees the volatile state of the map,
+ * must not be called concurrently with any other operation on the map
+ */
+static void
+skiplist_state_drop(PMEMoid map)
+{
+	pthread_mutex_lock(&skiplist_states_lock);
+
+	struct skiplist_state **sp = &skiplist_states;
+	while (*sp != NULL) {
+		struct skiplist_state *s = *sp;
+		if (s->pool_uuid_lo == map.pool_uuid_lo && s->off == map.off) {
+			*sp = s->next;
+			skiplist_state_free(s);
+			break;
+		}
+		sp = &s->next;
+	}
+
+	pthread_mutex_unlock(&skiplist_states_lock);
+}
+
+/*
+ * skiplist_state_get -- (internal) returns the volatile state of the map,
+ * rebuilds it on the first access after the pool is opened
+ */
+static struct skiplist_state *
+skiplist_state_get(PMEMobjpool *pop, PMEMoid map)
+{
+	struct skiplist_state *s = skiplist_state_find(map);
+	if (s != NULL)
+		return s;
+
+	pthread_mutex_lock(&skiplist_states_lock);
+
+	s = skiplist_state_find(map);
+	if (s == NULL) {
+		s = skiplist_state_new(pop, map);
+		if (s != NULL) {
+			s->next = skiplist_states;
+			__atomic_store_n(&skiplist_states, s,
+					__ATOMIC_RELEASE);
+		}
+	}
+
+	pthread_mutex_unlock(&skiplist_states_lock);
+
+	return s;
+}
+
+/*
+ * skiplist_map_create -- (internal) constructor of the map
+ */
+static int
+skiplist_map_create(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	struct skiplist_map *m = ptr;
+
+	PM_EQU(m->flags, *(unsigned *)arg);
+	PM_EQU(m->head.key, 0);
+	PM_EQU(m->head.value, 0);
+	PM_EQU(m->head.next, 0);
+	PM_EQU(m->head.map, (uintptr_t)ptr - (uintptr_t)pop);
+
+	pmemobj_persist(pop, m, sizeof(*m));
+
+	return 0;
+}
+
+/*
+ * skiplist_map_new -- allocates a new skip list instance
+ */
+int
+skiplist_map_new(PMEMobjpool *pop, TOID(struct skiplist_map) *map,
+	unsigned flags)
+{
+	return pmemobj_alloc(pop, &map->oid, sizeof(struct skiplist_map),
+		TOID_TYPE_NUM(struct skiplist_map),
+		skiplist_map_create, &flags) != 0;
+}
+
+/*
+ * skiplist_map_init -- rebuilds the volatile state, called after
+ * pmemobj_open
+ */
+int
+skiplist_map_init(PMEMobjpool *pop, TOID(struct skiplist_map) map)
+{
+	skiplist_state_drop(map.oid);
+
+	return skiplist_state_get(pop, map.oid) == NULL;
+}
+
+/*
+ * skiplist_map_clear -- removes all elements from the map
+ */
+int
+skiplist_map_clear(PMEMobjpool *pop, TOID(struct skiplist_map) map)
+{
+	struct skiplist_state *s = skiplist_state_get(pop, map.oid);
+	if (s == NULL)
+		return 1;
+
+	uint64_t head = s->head->entry;
+	uint64_t curr;
+	while ((curr = skiplist_entry_seek(pop, s, head, 0)) != 0)
+		skiplist_map_remove(pop, map, ENTRY(pop, curr)->key);
+
+	return 0;
+}
+
+/*
+ * skiplist_map_delete -- cleanups and frees skip list instance
+ */
+int
+skiplist_map_delete(PMEMobjpool *pop, TOID(struct skiplist_map) *map)
+{
+	if (skiplist_map_clear(pop, *map))
+		return 1;
+
+	skiplist_state_drop(map->oid);
+	pmemobj_free(&map->oid);
+
+	return 0;
+}
+
+/*
+ * skiplist_entry_create -- (internal) constructor of an entry
+ */
+static int
+skiplist_entry_create(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	struct skiplist_map_entry *e = ptr;
+	struct skiplist_map_entry *args = arg;
+
+	PM_EQU(e->key, args->key);
+	PM_EQU(e->value, args->value);
+	PM_EQU(e->next, args->next);
+	PM_EQU(e->map, args->map);
+
+	pmemobj_persist(pop, e, sizeof(*e));
+
+	return 0;
+}
+
+/*
+ * skiplist_map_insert -- inserts a new key-value pair into the map
+ */
+int
+skiplist_map_insert(PMEMobjpool *pop, TOID(struct skiplist_map) map,
+	uint64_t key, PMEMoid value)
+{
+	struct skiplist_state *s = skiplist_state_get(pop, map.oid);
+	if (s == NULL)
+		return 1;
+
+	assert((value.off & SKIPLIST_FLAGS) == 0);
+
+	int ret = 0;
+	skiplist_enter(s);
+
+	struct skiplist_tower *preds[SKIPLIST_LEVELS];
+	struct skiplist_tower *succs[SKIPLIST_LEVELS];
+	uint64_t start = skiplist_tower_find(s, key, 0, preds, succs);
+
+	struct skiplist_map_entry args = {key, value.off, 0, map.oid.off};
+	PMEMoid new = OID_NULL;
+	for (;;) {
+		uint64_t pred;
+		uint64_t curr = skiplist_entry_find(pop, s, start, key, &pred);
+		if (curr != 0 && ENTRY(pop, curr)->key == key) {
+			/* the key exists, replace the value */
+			struct skiplist_map_entry *e = ENTRY(pop, curr);
+			uint64_t old;
+			do {
+				old = skiplist_load(pop, &e->value);
+			} while (!skiplist_cas(pop, &e->value, old,
+					value.off));
+
+			pmemobj_free(&new);
+			goto out;
+		}
+
+		if (OID_IS_NULL(new)) {
+			args.next = curr;
+			if (pmemobj_alloc(pop, &new, sizeof(args),
+				TOID_TYPE_NUM(struct skiplist_map_entry),
+				skiplist_entry_create, &args)) {
+				ret = 1;
+				goto out;
+			}
+			assert((new.off & SKIPLIST_FLAGS) == 0);
+		} else if (ENTRY(pop, new.off)->next != curr) {
+			/* the entry is not reachable yet */
+			PM_EQU(ENTRY(pop, new.off)->next, curr);
+			pmemobj_persist(pop, &ENTRY(pop, new.off)->next,
+					sizeof(uint64_t));
+		}
+
+		/* publish the entry */
+		if (skiplist_cas(pop, &ENTRY(pop, pred)->next, curr, new.off))
+			break;
+
+		start = pred;
+	}
+
+	__sync_fetch_and_add(&s->count, 1);
+
+	/* without a tower the entry is reachable from the bottom level only */
+	int height = skiplist_random_height();
+	if (height != 0) {
+		struct skiplist_tower *t =
+			skiplist_tower_new(key, new.off, height);
+		if (t != NULL)
+			skiplist_tower_insert(pop, s, t, preds, succs);
+	}
+out:
+	skiplist_exit(s);
+
+	return ret;
+}
+
+struct skiplist_value_args {
+	void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg);
+	void *arg;
+};
+
+/*
+ * skiplist_value_create -- (internal) calls the constructor of a new value
+ */
+static int
+skiplist_value_create(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	struct skiplist_value_args *args = arg;
+	args->constructor(pop, ptr, args->arg);
+
+	return 0;
+}
+
+/*
+ * skiplist_map_insert_new -- allocates a new object and inserts it into
+ * the map, the object leaks if the insertion is interrupted
+ */
+int
+skiplist_map_insert_new(PMEMobjpool *pop, TOID(struct skiplist_map) map,
+		uint64_t key, size_t size, unsigned int type_num,
+		void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg),
+		void *arg)
+{
+	struct skiplist_value_args args = {constructor, arg};
+	PMEMoid n;
+	if (pmemobj_alloc(pop, &n, size, type_num,
+			skiplist_value_create, &args))
+		return 1;
+
+	return skiplist_map_insert(pop, map, key, n);
+}
+
+/*
+ * skiplist_map_remove -- removes key-value pair from the map
+ */
+PMEMoid
+skiplist_map_remove(PMEMobjpool *pop, TOID(struct skiplist_map) map,
+	uint64_t key)
+{
+	struct skiplist_state *s = skiplist_state_get(pop, map.oid);
+	if (s == NULL)
+		return OID_NULL;
+
+	PMEMoid ret = OID_NULL;
+	skiplist_enter(s);
+
+	uint64_t start = skiplist_tower_find(s, key, 0, NULL, NULL);
+	uint64_t pred;
+	uint64_t curr;
+	uint64_t next;
+	struct skiplist_map_entry *e;
+	for (;;) {
+		curr = skiplist_entry_find(pop, s, start, key, &pred);
+		if (curr == 0 || ENTRY(pop, curr)->key != key)
+			goto out;
+
+		/* marking the link is the durable point of the removal */
+		e = ENTRY(pop, curr);
+		next = skiplist_load(pop, &e->next);
+		if (!LINK_REMOVED(next) && skiplist_cas(pop, &e->next,
+				next, next | SKIPLIST_REMOVED))
+			break;
+
+		start = pred;
+	}
+
+	ret = skiplist_value(pop, s, e);
+	__sync_fetch_and_sub(&s->count, 1);
+
+	/* unlink the entry or let the search do it */
+	if (!skiplist_cas(pop, &ENTRY(pop, pred)->next, curr, next))
+		skiplist_entry_find(pop, s, s->head->entry, key, &pred);
+
+	struct skiplist_tower *t = skiplist_tower_lookup(s, key, curr);
+	if (t != NULL)
+		skiplist_tower_remove(s, t);
+
+	skiplist_retire(s, NULL, curr);
+out:
+	skiplist_exit(s);
+
+	return ret;
+}
+
+/*
+ * skiplist_map_remove_free -- removes and frees an object from the map
+ */
+int
+skiplist_map_remove_free(PMEMobjpool *pop, TOID(struct skiplist_map) map,
+		uint64_t key)
+{
+	PMEMoid val = skiplist_map_remove(pop, map, key);
+	pmemobj_free(&val);
+
+	return 0;
+}
+
+/*
+ * skiplist_map_get_entry -- (internal) searches for the entry of the key
+ */
+static struct skiplist_map_entry *
+skiplist_map_get_entry(PMEMobjpool *pop, struct skiplist_state *s,
+	uint64_t key)
+{
+	uint64_t start = skiplist_tower_find(s, key, 0, NULL, NULL);
+	uint64_t curr = skiplist_entry_seek(pop, s, start, key);
+	if (curr == 0 || ENTRY(pop, curr)->key != key)
+		return NULL;
+
+	return ENTRY(pop, curr);
+}
+
+/*
+ * skiplist_map_get -- searches for a value of the key
+ */
+PMEMoid
+skiplist_map_get(PMEMobjpool *pop, TOID(struct skiplist_map) map,
+	uint64_t key)
+{
+	struct skiplist_state *s = skiplist_state_get(pop, map.oid);
+	if (s == NULL)
+		return OID_NULL;
+
+	skiplist_enter(s);
+
+	PMEMoid ret = OID_NULL;
+	struct skiplist_map_entry *e = skiplist_map_get_entry(pop, s, key);
+	if (e != NULL)
+		ret = skiplist_value(pop, s, e);
+
+	skiplist_exit(s);
+
+	return ret;
+}
+
+/*
+ * skiplist_map_lookup -- searches if a key exists
+ */
+int
+skiplist_map_lookup(PMEMobjpool *pop, TOID(struct skiplist_map) map,
+	uint64_t key)
+{
+	struct skiplist_state *s = skiplist_state_get(pop, map.oid);
+	if (s == NULL)
+		return 0;
+
+	skiplist_enter(s);
+	int ret = skiplist_map_get_entry(pop, s, key) != NULL;
+	skiplist_exit(s);
+
+	return ret;
+}
+
+/*
+ * skiplist_map_range -- visits, in ascending order, all key-value pairs with
+ * keys from the <start, end> range until the callback returns non-zero
+ */
+int
+skiplist_map_range(PMEMobjpool *pop, TOID(struct skiplist_map) map,
+	uint64_t start, uint64_t end,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	if (start > end)
+		return 0;
+
+	struct skiplist_state *s = skiplist_state_get(pop, map.oid);
+	if (s == NULL)
+		return 1;
+
+	skiplist_enter(s);
+
+	int ret = 0;
+	uint64_t curr = skiplist_entry_seek(pop, s,
+		skiplist_tower_find(s, start, 0, NULL, NULL), start);
+	while (curr != 0) {
+		struct skiplist_map_entry *e = ENTRY(pop, curr);
+		uint64_t next = skiplist_load(pop, &e->next);
+		if (!LINK_REMOVED(next)) {
+			if (e->key > end)
+				break;
+
+			if (cb(e->key, skiplist_value(pop, s, e), arg)) {
+				ret = 1;
+				break;
+			}
+		}
+
+		curr = LINK_OFF(next);
+	}
+
+	skiplist_exit(s);
+
+	return ret;
+}
+
+/*
+ * skiplist_map_foreach -- calls function for each node on a list
+ */
+int
+skiplist_map_foreach(PMEMobjpool *pop, TOID(struct skiplist_map) map,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	return skiplist_map_range(pop, map, 0, UINT64_MAX, cb, arg);
+}
+
+/*
+ * skiplist_map_is_empty -- checks whether the map is empty
+ */
+int
+skiplist_map_is_empty(PMEMobjpool *pop, TOID(struct skiplist_map) map)
+{
+	struct skiplist_state *s = skiplist_state_get(pop, map.oid);
+	if (s == NULL)
+		return 1;
+
+	skiplist_enter(s);
+	int ret = skiplist_entry_seek(pop, s, s->head->entry, 0) == 0;
+	skiplist_exit(s);
+
+	return ret;
+}
+
+/*
+ * skiplist_map_count -- returns the number of elements in the map
+ */
+size_t
+skiplist_map_count(PMEMobjpool *pop, TOID(struct skiplist_map) map)
+{
+	struct skiplist_state *s = skiplist_state_get(pop, map.oid);
+	if (s == NULL)
+		return 0;
+
+	return __atomic_load_n(&s->count, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * skiplist_map_check -- check if given persistent object is a skip list
+ */
+int
+skiplist_map_check(PMEMobjpool *pop, TOID(struct skiplist_map) map)
+{
+	return TOID_IS_NULL(map) || !TOID_VALID(map);
+}